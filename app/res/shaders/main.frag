@@ -18,9 +18,7 @@ uniform float parallaxDepth;
 
 uniform sampler2D albedo;
 uniform sampler2D normalMap;
-uniform sampler2D roughnessMap;
-uniform sampler2D metalMap;
-uniform sampler2D ambientOccMap;
+uniform sampler2D ormMap; // ambient occlusion, roughness and metal
 uniform sampler2D displacementMap;
 
 layout(location = 0) out vec4 fragColor;
@@ -110,9 +108,10 @@ void main()
     }
 
 	vec3 color = pow(texture(albedo, finalTexCoords).rgb, vec3(2.2));
-	float metallic = texture(metalMap, finalTexCoords).r;
-	float roughness = texture(roughnessMap, finalTexCoords).r;
-	float ambientOcc = texture(ambientOccMap, finalTexCoords).r;
+	vec3 orm = texture(ormMap, finalTexCoords).rgb;
+	float ambientOcc = orm.r;
+	float roughness = orm.g;
+	float metallic = orm.b;
 
 	vec3 normal = normalize(texture(normalMap, finalTexCoords).rgb * 2.0 - 1.0);
     normal = normalize(TBN * normal);
@@ -17,6 +17,13 @@ void TextureExtrasExtender::addOwnGroups(Configuration& config, std::string newG
                                         {"2048x2048", "Very High Quality"},
                                         {"4096x4096", "Extreme Quality"}},
                                        &textureSizeChoice});
+  textureExtrasGroup.singleChoices.emplace_back(Configuration::SingleChoiceEntry{
+      {"Sampling", "Choose how many samples are averaged for every texel of the textures."},
+      {{"Single", "One sample in the center of the texel, fast previews."},
+       {"Rotated Grid", "Four samples on a rotated 2x2 grid."},
+       {"Grid", "Nine samples on a 3x3 grid, best quality."},
+       {"Adaptive", "One sample, nine samples where the neighbouring texels differ."}},
+      &samplingChoice});
 
   textureExtrasGroup.bools.push_back(Configuration::SimpleEntry<bool>{
       {"Variance", "Add some variance to the texture to make it appear more natural."},
@@ -76,6 +83,7 @@ void TextureExtrasExtender::setupPipeline(Pipeline* pipeline) {
 }
 void TextureExtrasExtender::updatePipeline(Pipeline* pipeline) {
   pipeline->getParameterizer().textureSizeChoice = textureSizeChoice;
+  pipeline->getParameterizer().samplingChoice = samplingChoice;
   updateTextureAdderVariance();
   updateTextureAdderSpots();
   updateTextureAdderVeins();
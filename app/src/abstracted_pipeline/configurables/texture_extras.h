@@ -39,6 +39,7 @@ class TextureExtrasExtender : public AbstractedPipelineExtender {
   } spots;
 
   int textureSizeChoice = 2;
+  int samplingChoice = 2;
 
   NoiseTextureAdder* textureAdderVariance;
   NoiseTextureAdder* textureAdderSpots;
@@ -4,6 +4,7 @@
 #include <procrocklib/mod/subdivision_modifier.h>
 #include <procrocklib/par/xatlas_parameterizer.h>
 #include <procrocklib/texgen/noise_texture_generator.h>
+#include <procrocklib/texture_packing.h>
 
 #include <iostream>
 
@@ -154,6 +155,7 @@ bool App::init() {
   pipeline->addModifier(std::make_unique<SubdivisionModifier>());
   pipeline->setParameterizer(std::make_unique<XAtlasParameterizer>());
   pipeline->setTextureGenerator(std::make_unique<NoiseTextureGenerator>());
+  executor = std::make_unique<PipelineExecutor>();
 
   mainShader = std::make_unique<Shader>(resourcesPath + "/shaders/main.vert",
                                         resourcesPath + "/shaders/main.frag");
@@ -166,41 +168,35 @@ bool App::init() {
 
   rockTexGroup["albedo"] = std::make_unique<RenderTexture>();
   rockTexGroup["normalMap"] = std::make_unique<RenderTexture>();
-  rockTexGroup["roughnessMap"] = std::make_unique<RenderTexture>();
-  rockTexGroup["metalMap"] = std::make_unique<RenderTexture>();
-  rockTexGroup["ambientOccMap"] = std::make_unique<RenderTexture>();
+  rockTexGroup["ormMap"] = std::make_unique<RenderTexture>();
   rockTexGroup["displacementMap"] = std::make_unique<RenderTexture>();
 
   groundTexGroups[0]["albedo"] = std::make_unique<RenderTexture>();
   groundTexGroups[0]["albedo"]->loadFromFile(resourcesPath + "/textures/gravel/albedo.jpg");
   groundTexGroups[0]["normalMap"] = std::make_unique<RenderTexture>();
   groundTexGroups[0]["normalMap"]->loadFromFile(resourcesPath + "/textures/gravel/normals.jpg");
-  groundTexGroups[0]["roughnessMap"] = std::make_unique<RenderTexture>();
-  groundTexGroups[0]["roughnessMap"]->loadFromFile(resourcesPath +
-                                                   "/textures/gravel/roughness.jpg");
-  groundTexGroups[0]["ambientOccMap"] = std::make_unique<RenderTexture>();
-  groundTexGroups[0]["ambientOccMap"]->loadFromFile(resourcesPath +
-                                                    "/textures/gravel/ambientOcc.jpg");
+  groundTexGroups[0]["ormMap"] = std::make_unique<RenderTexture>();
+  groundTexGroups[0]["ormMap"]->loadPackedFromFiles(
+      {resourcesPath + "/textures/gravel/ambientOcc.jpg",
+       resourcesPath + "/textures/gravel/roughness.jpg", ""},
+      {255, 255, 0});
   groundTexGroups[0]["displacementMap"] = std::make_unique<RenderTexture>();
   groundTexGroups[0]["displacementMap"]->loadFromFile(resourcesPath +
                                                       "/textures/gravel/displacement.jpg");
-  groundTexGroups[0]["metalMap"] = std::make_unique<RenderTexture>();
 
   groundTexGroups[1]["albedo"] = std::make_unique<RenderTexture>();
   groundTexGroups[1]["albedo"]->loadFromFile(resourcesPath + "/textures/mossy/albedo.jpg");
   groundTexGroups[1]["normalMap"] = std::make_unique<RenderTexture>();
   groundTexGroups[1]["normalMap"]->loadFromFile(resourcesPath + "/textures/mossy/normals.jpg");
-  groundTexGroups[1]["roughnessMap"] = std::make_unique<RenderTexture>();
-  groundTexGroups[1]["roughnessMap"]->loadFromFile(resourcesPath + "/textures/mossy/roughness.jpg");
-  groundTexGroups[1]["ambientOccMap"] = std::make_unique<RenderTexture>();
-  groundTexGroups[1]["ambientOccMap"]->loadFromFile(resourcesPath +
-                                                    "/textures/mossy/ambientOcc.jpg");
+  groundTexGroups[1]["ormMap"] = std::make_unique<RenderTexture>();
+  groundTexGroups[1]["ormMap"]->loadPackedFromFiles(
+      {resourcesPath + "/textures/mossy/ambientOcc.jpg",
+       resourcesPath + "/textures/mossy/roughness.jpg", ""},
+      {255, 255, 0});
   groundTexGroups[1]["displacementMap"] = std::make_unique<RenderTexture>();
   groundTexGroups[1]["displacementMap"]->loadFromFile(resourcesPath +
                                                       "/textures/mossy/displacement.jpg");
 
-  groundTexGroups[1]["metalMap"] = std::make_unique<RenderTexture>();
-
   InputManager::registerInputReceiver(mainCam.get());
 
   glEnable(GL_CULL_FACE);
@@ -210,40 +206,53 @@ bool App::init() {
 }
 
 bool App::update() {
-  if (pipeline->isChanged()) {
-    auto mesh = pipeline->getCurrentMesh();
+  PipelineExecutor::Result result;
+  if (executor->takeResult(result)) {
+    auto mesh = result.mesh;
     drawableMesh = std::make_unique<DrawableMesh>(*mesh);
 
-    rockTexGroup["albedo"]->loadFromData(mesh->textures.albedoData.data(), mesh->textures.width,
+    rockTexGroup["albedo"]->loadFromData(mesh->textures.albedoData->data(), mesh->textures.width,
                                          mesh->textures.height);
 
-    rockTexGroup["normalMap"]->loadFromData(mesh->textures.normalData.data(), mesh->textures.width,
+    rockTexGroup["normalMap"]->loadFromData(mesh->textures.normalData->data(), mesh->textures.width,
                                             mesh->textures.height);
 
-    rockTexGroup["roughnessMap"]->loadFromData(mesh->textures.roughnessData.data(),
-                                               mesh->textures.width, mesh->textures.height, 1);
-
-    rockTexGroup["metalMap"]->loadFromData(mesh->textures.metalData.data(), mesh->textures.width,
-                                           mesh->textures.height, 1);
+    // One texture for ambient occlusion, roughness and metal instead of a bind each
+    auto orm = packChannels(mesh->textures, ChannelPacking::orm());
+    rockTexGroup["ormMap"]->loadFromData(orm.data(), mesh->textures.width, mesh->textures.height);
 
-    rockTexGroup["ambientOccMap"]->loadFromData(mesh->textures.ambientOccData.data(),
-                                                mesh->textures.width, mesh->textures.height, 1);
-
-    rockTexGroup["displacementMap"]->loadFromData(mesh->textures.displacementData.data(),
+    rockTexGroup["displacementMap"]->loadFromData(mesh->textures.displacementData->data(),
                                                   mesh->textures.width, mesh->textures.height, 1);
 
     gui::windows.meshInfoWindow.vertices = mesh->vertices.rows();
     gui::windows.meshInfoWindow.faces = mesh->faces.rows();
     gui::windows.meshInfoWindow.textureWidth = mesh->textures.width;
     gui::windows.meshInfoWindow.textureHeight = mesh->textures.height;
+    gui::windows.meshInfoWindow.profile = result.profile;
+    showingPreview = result.preview;
   }
 
   gui::sideBar.currentAbstractedPipeline = abstractedPipeline.get();
-  gui::update(this->getWindowSize(), *viewerFramebuffer, *pipeline, *mainShader);
+  gui::statusBar.generating = executor->isBusy();
+  gui::statusBar.refining = gui::statusBar.generating && showingPreview;
+  gui::statusBar.exporting = executor->isExporting();
+  gui::statusBar.error = executor->getLastError();
+  gui::update(this->getWindowSize(), *viewerFramebuffer, *pipeline, *executor, *mainShader);
   if (abstractedPipeline != nullptr) {
     abstractedPipeline->update();
   }
 
+  // The executor gets a snapshot of every edit, older runs still in progress are cancelled
+  executor->setProgressive(gui::windows.viewSettingsWindow.progressivePreview);
+  if (pipeline->isChanged()) {
+    auto snapshot = pipeline->saveToString();
+    if (snapshot != submittedSnapshot) {
+      executor->submit(snapshot);
+      submittedSnapshot = snapshot;
+    }
+    pipeline->markUnchanged();
+  }
+
   mainCam->setViewport(gui::viewer.size);
   mainShader->uniforms3f["camPos"] = mainCam->getPosition();
 
@@ -283,7 +292,7 @@ bool App::render() {
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   viewerFramebuffer->bind();
-  drawableMesh->draw(*mainCam, *mainShader);
+  if (drawableMesh != nullptr) drawableMesh->draw(*mainCam, *mainShader);
   if (gui::windows.viewSettingsWindow.groundPlane.show) {
     for (auto& pair : groundTexGroups[gui::windows.viewSettingsWindow.groundPlane.textureChoice]) {
       mainShader->textures[pair.first] = pair.second.get();
@@ -298,7 +307,10 @@ bool App::render() {
   return true;
 }
 
-bool App::end() { return true; }
+bool App::end() {
+  executor.reset();  // cancels and joins the worker
+  return true;
+}
 
 glm::uvec2 App::getFrameBufferSize() const {
   glm::ivec2 sizes(0);
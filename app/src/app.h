@@ -1,5 +1,6 @@
 #pragma once
 #include <procrocklib/pipeline.h>
+#include <procrocklib/pipeline_executor.h>
 
 #include <glm/glm.hpp>
 #include <memory>
@@ -50,7 +51,10 @@ class App {
 
   std::map<std::string, std::unique_ptr<RenderTexture>> rockTexGroup;
 
-  std::unique_ptr<Pipeline> pipeline;
+  std::unique_ptr<Pipeline> pipeline;  // edited by the gui, run by the executor
+  std::unique_ptr<PipelineExecutor> executor;
+  std::string submittedSnapshot;
+  bool showingPreview = false;
   std::unique_ptr<AbstractedPipeline> abstractedPipeline;
   std::unique_ptr<DrawableMesh> drawableMesh;
   std::unique_ptr<Framebuffer> viewerFramebuffer;
@@ -46,7 +46,7 @@ void init(GLFWwindow* window, const std::string& path) {
 }
 
 void update(glm::uvec2 windowSize, Framebuffer& viewerFrame, Pipeline& pipeline,
-            const Shader& shader) {
+            PipelineExecutor& executor, const Shader& shader) {
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplGlfw_NewFrame();
   ImGui::NewFrame();
@@ -57,7 +57,7 @@ void update(glm::uvec2 windowSize, Framebuffer& viewerFrame, Pipeline& pipeline,
   updateViewer(windowSize, viewerFrame);
   updateStatusBar(windowSize);
   updateWindows(shader);
-  updatePopups(pipeline);
+  updatePopups(executor);
 
   if (noiseNodeEditor.current != nullptr) {
     noiseNodeEditor.position =
@@ -332,6 +332,17 @@ void updateStatusBar(glm::uvec2 windowSize) {
                    ImGuiWindowFlags_NoBringToFrontOnFocus);
 
   ImGui::Text("Proc-Rock InDev");
+  ImGui::SameLine();
+  if (statusBar.exporting) {
+    ImGui::Text(ICON_FA_SPINNER " Exporting...");
+  } else if (statusBar.refining) {
+    ImGui::Text(ICON_FA_SPINNER " Refining preview...");
+  } else if (statusBar.generating) {
+    ImGui::Text(ICON_FA_SPINNER " Generating...");
+  } else if (!statusBar.error.empty()) {
+    ImGui::TextColored(ImVec4(1, 0.3f, 0.3f, 1), ICON_FA_EXCLAMATION_TRIANGLE " %s",
+                       statusBar.error.c_str());
+  }
   ImGui::SameLine((float)windowSize.x - 370);
   ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate,
               ImGui::GetIO().Framerate);
@@ -361,6 +372,11 @@ void updateWindows(const Shader& shader) {
     ImGui::SetNextWindowSizeConstraints(ImVec2(sideBar.width, 0), ImVec2(FLT_MAX, FLT_MAX));
     ImGui::Begin("View Settings", &windows.viewSettingsWindow.show);
     ImGui::Checkbox("Wireframe Mode", &windows.viewSettingsWindow.wireframe);
+    ImGui::Checkbox("Progressive Preview", &windows.viewSettingsWindow.progressivePreview);
+    ImGui::SameLine();
+    std::string progressiveHelp =
+        "Show a quick low resolution preview first and refine it in the background.";
+    helpMarker(progressiveHelp);
     ImGui::Checkbox("Enable Parallax", &windows.viewSettingsWindow.enableParallax);
     ImGui::SliderFloat("Parallax Depth", &windows.viewSettingsWindow.parallaxDepth, 0.001, 0.1);
 
@@ -416,11 +432,51 @@ void updateWindows(const Shader& shader) {
     ImGui::Text("Texture Height");
     ImGui::NextColumn();
     ImGui::Text(std::to_string(windows.meshInfoWindow.textureHeight).c_str());
+    ImGui::Columns(1);
+
+    const auto& profile = windows.meshInfoWindow.profile;
+    ImGui::Separator();
+    ImGui::Text("Last Run: %.1fms wall, %.1fms process cpu", profile.wallMs,
+                profile.processCpuMs);
+    ImGui::Columns(5);
+    ImGui::Text("Stage");
+    ImGui::NextColumn();
+    ImGui::Text("Wall");
+    ImGui::NextColumn();
+    ImGui::Text("Process CPU");
+    ImGui::NextColumn();
+    ImGui::Text("Process Peak");
+    ImGui::NextColumn();
+    ImGui::Text("Faces");
+    ImGui::NextColumn();
+    for (const auto& stage : profile.stages) {
+      ImGui::Text("%s", stage.name.c_str());
+      if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s, %s", getStageTypeName(stage.type),
+                          getStageResultName(stage.result));
+      }
+      ImGui::NextColumn();
+      ImGui::Text("%.1fms", stage.wallMs);
+      ImGui::NextColumn();
+      ImGui::Text("%.1fms", stage.processCpuMs);
+      ImGui::NextColumn();
+      ImGui::Text("%.1fMB", stage.processPeakMemory / (1024.0 * 1024.0));
+      ImGui::NextColumn();
+      ImGui::Text("%d -> %d", stage.inputFaces, stage.outputFaces);
+      ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+
+    if (ImGui::Button("Copy as JSON")) ImGui::SetClipboardText(profile.toJson().c_str());
+    ImGui::SameLine();
+    if (ImGui::Button("Copy as Chrome Trace")) {
+      ImGui::SetClipboardText(profile.toChromeTrace().c_str());
+    }
     ImGui::End();
   }
 }
 
-void updatePopups(Pipeline& pipeline) {
+void updatePopups(PipelineExecutor& executor) {
   ImVec2 center(ImGui::GetIO().DisplaySize.x * 0.5f, ImGui::GetIO().DisplaySize.y * 0.5f);
   ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
 
@@ -434,6 +490,13 @@ void updatePopups(Pipeline& pipeline) {
     ImGui::Text("Export the current rock to disk.\n\n");
     ImGui::Separator();
 
+    ImGui::Checkbox("Binary glTF (GLB)", &p.exportGlb);
+    ImGui::SameLine();
+    std::string exportGlbHelp =
+        "One file with all LODs and the textures embedded as pngs. Ambient occlusion, roughness "
+        "and metal are packed into one texture, displacement is not part of glTF.";
+    helpMarker(exportGlbHelp);
+
     ImGui::Checkbox("Export LODs", &p.exportLODs);
 
     if (windows.exportPopup.exportLODs) {
@@ -452,16 +515,80 @@ void updatePopups(Pipeline& pipeline) {
     ImGui::Checkbox("Metal", &p.exportMetal);
     ImGui::Checkbox("Displacement", &p.exportDisplacement);
     ImGui::Checkbox("Ambient Occ.", &p.exportAmbientOcc);
+    const unsigned int packableChannels[] = {0, TextureGroup::Roughness, TextureGroup::Metal,
+                                             TextureGroup::AmbientOcc, TextureGroup::Displacement};
+    if (!p.exportGlb) {
+      ImGui::Checkbox("Pack Channels", &p.packTextures);
+      ImGui::SameLine();
+      std::string packTexturesHelp =
+          "The channels of the layout go into one texture instead of a file each. Glb files "
+          "always pack ambient occlusion, roughness and metal.";
+      helpMarker(packTexturesHelp);
+    }
+    if (p.packTextures && !p.exportGlb) {
+      const char* layouts[] = {"ORM", "RMA", "Custom"};
+      ImGui::Combo("Layout", &p.packingChoice, layouts, IM_ARRAYSIZE(layouts));
+      if (p.packingChoice == 2) {
+        const char* labels[] = {"Red", "Green", "Blue", "Alpha"};
+        const char* items[] = {"None", "Roughness", "Metal", "Ambient Occ.", "Displacement"};
+        for (int c = 0; c < 4; c++) {
+          ImGui::Combo(labels[c], &p.customPacking[c], items, IM_ARRAYSIZE(items));
+        }
+      }
+    }
+    if (p.exportDisplacement && !p.exportGlb) {
+      const char* formats[] = {"8 bit", "16 bit PNG", "32 bit EXR", "32 bit Raw"};
+      ImGui::Combo("Displacement Format", &p.displacementFormat, formats, IM_ARRAYSIZE(formats));
+      ImGui::SameLine();
+      std::string displacementFormatHelp =
+          "Height maps band in 8 bits. Raw files are little endian floats without a header, "
+          "row by row from the top.";
+      helpMarker(displacementFormatHelp);
+    }
+    ImGui::SliderInt("Texture Padding", &p.texturePadding, 0, 64);
+    ImGui::SameLine();
+    std::string texturePaddingHelp =
+        "Texels around the uv islands get the colors of the closest island texels, so "
+        "filtering and mip maps show no seams. 0 disables the padding.";
+    helpMarker(texturePaddingHelp);
+    if (!p.exportGlb) {
+      ImGui::Checkbox("GPU Compressed (DDS)", &p.compressTextures);
+      ImGui::SameLine();
+      std::string compressTexturesHelp =
+          "Writes block compressed dds files with mip maps instead of pngs, ready for the gpu. "
+          "Normals use BC5, the single channels BC4.";
+      helpMarker(compressTexturesHelp);
+    }
+    if (p.compressTextures && !p.exportGlb) {
+      ImGui::Checkbox("BC7 Albedo", &p.albedoBC7);
+      ImGui::SameLine();
+      std::string albedoBC7Help = "Better quality than BC1 with twice the size.";
+      helpMarker(albedoBC7Help);
+    } else {
+      ImGui::SliderInt("PNG Compression", &p.compressionLevel, 0, 9);
+      ImGui::SameLine();
+      std::string compressionLevelHelp = "0 writes the fastest, 9 the smallest files.";
+      helpMarker(compressionLevelHelp);
+    }
 
     ImGui::Separator();
 
     if (ImGui::Button("Export", ImVec2(120, 0))) {
-      const char* patterns[] = {"*.obj"};
+      const char* patterns[] = {p.exportGlb ? "*.glb" : "*.obj"};
       const char* file = tinyfd_saveFileDialog("Export mesh", "", 1, patterns, NULL);
       if (file != NULL) {
-        pipeline.exportCurrent(
-            file, {p.exportLODs, p.lodCount, p.lodTextures, p.exportAlbedo, p.exportNormals,
-                   p.exportRoughness, p.exportMetal, p.exportDisplacement, p.exportAmbientOcc});
+        ChannelPacking packing =
+            p.packingChoice == 1 ? ChannelPacking::rma() : ChannelPacking::orm();
+        if (p.packingChoice == 2) {
+          packing = ChannelPacking();
+          for (int c = 0; c < 4; c++) packing.sources[c] = packableChannels[p.customPacking[c]];
+        }
+        executor.submitExport(
+            file, {p.exportGlb, p.exportLODs, p.lodCount, p.lodTextures, p.exportAlbedo,
+                   p.exportNormals, p.exportRoughness, p.exportMetal, p.exportDisplacement,
+                   p.exportAmbientOcc, p.texturePadding, p.compressionLevel, p.compressTextures,
+                   p.albedoBC7, p.packTextures, packing,
+                   (DisplacementFormat)p.displacementFormat});
       }
       ImGui::CloseCurrentPopup();
     }
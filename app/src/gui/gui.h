@@ -4,6 +4,7 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 #include <procrocklib/pipeline.h>
+#include <procrocklib/pipeline_executor.h>
 
 #include <glm/glm.hpp>
 #include <iostream>
@@ -19,7 +20,7 @@ namespace gui {
 
 void init(GLFWwindow* window, const std::string& path);
 void update(glm::uvec2 windowSize, Framebuffer& viewerFrame, Pipeline& pipeline,
-            const Shader& shader);
+            PipelineExecutor& executor, const Shader& shader);
 
 void updateMainMenu(Pipeline& pipeline);
 void updateSideBar(glm::uvec2 windowSize, Pipeline& pipeline);
@@ -27,7 +28,7 @@ void udpateCurrentStageEditor(glm::uvec2 windowSize);
 void updateViewer(glm::uvec2 windowSize, Framebuffer& viewerFrame);
 void updateStatusBar(glm::uvec2 windowSize);
 void updateWindows(const Shader& shader);
-void updatePopups(Pipeline& pipeline);
+void updatePopups(PipelineExecutor& executor);
 
 void updatePipelineStage(Pipeline& pipeline, PipelineStage& stage);
 void updateConfigurable(Configurable& configurable);
@@ -66,6 +67,11 @@ struct Viewer {
 
 struct StatusBar {
   const int height = 35;
+
+  bool generating = false;
+  bool refining = false;  // a preview is shown while the full result is generated
+  bool exporting = false;
+  std::string error;
 };
 
 struct Window {
@@ -76,6 +82,7 @@ struct TextureWindow : public Window {};
 
 struct ViewSettingsWindow : public Window {
   bool wireframe = false;
+  bool progressivePreview = true;
   bool enableParallax = false;
   float parallaxDepth = 0.01;
   glm::vec3 clearColor = glm::vec3(0.6);
@@ -102,9 +109,12 @@ struct MeshInfoWindow : public Window {
   int faces = 0;
   int textureWidth = 0;
   int textureHeight = 0;
+  PipelineProfile profile;
 };
 
 struct ExportPopup : public Window {
+  bool exportGlb = false;
+
   bool exportLODs = false;
   int lodCount = 3;
   bool lodTextures = false;
@@ -115,6 +125,17 @@ struct ExportPopup : public Window {
   bool exportMetal = true;
   bool exportDisplacement = true;
   bool exportAmbientOcc = true;
+
+  int texturePadding = 16;
+  int compressionLevel = 6;
+  bool compressTextures = false;
+  bool albedoBC7 = true;
+
+  bool packTextures = false;
+  int packingChoice = 0;               // orm, rma or custom
+  int customPacking[4] = {3, 1, 2, 0};  // per channel, index into the packable channels
+
+  int displacementFormat = 0;  // bytes, 16 bit png, exr or raw floats
 };
 
 struct Windows {
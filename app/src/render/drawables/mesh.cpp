@@ -15,12 +15,12 @@ DrawableMesh::DrawableMesh(Mesh& mesh) {
   tangents.resize(positions.size());
   for (Eigen::Index i = 0; i < mesh.faces.rows(); ++i) {
     auto f_row = mesh.faces.row(i);
-    auto t_row = mesh.faceTangents.row(i);
+    auto t_col = mesh.faceFrames[i].col(0);
     this->faces.emplace_back(f_row(0), f_row(1), f_row(2));
 
-    this->tangents[mesh.faces.row(i).x()] = glm::vec3(t_row(0), t_row(1), t_row(2));
-    this->tangents[mesh.faces.row(i).y()] = glm::vec3(t_row(0), t_row(1), t_row(2));
-    this->tangents[mesh.faces.row(i).z()] = glm::vec3(t_row(0), t_row(1), t_row(2));
+    this->tangents[mesh.faces.row(i).x()] = glm::vec3(t_col(0), t_col(1), t_col(2));
+    this->tangents[mesh.faces.row(i).y()] = glm::vec3(t_col(0), t_col(1), t_col(2));
+    this->tangents[mesh.faces.row(i).z()] = glm::vec3(t_col(0), t_col(1), t_col(2));
   }
   createBuffers();
 }
@@ -2,6 +2,7 @@
 
 #include <stb_image.h>
 
+#include <cassert>
 #include <iostream>
 
 #include "gl_includes.h"
@@ -15,7 +16,8 @@ void RenderTexture::bind() const {
   glBindTexture(GL_TEXTURE_2D, ID);
 }
 void RenderTexture::unbind() const { glBindTexture(GL_TEXTURE_2D, 0); }
-void RenderTexture::loadFromData(unsigned char* data, int width, int height, int channels) {
+void RenderTexture::loadFromData(const unsigned char* data, int width, int height,
+                                 int channels) {
   size.x = width;
   size.y = height;
 
@@ -45,7 +47,7 @@ void RenderTexture::loadFromData(unsigned char* data, int width, int height, int
   glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void RenderTexture::loadFromData(float* data, int width, int height, int channels) {
+void RenderTexture::loadFromData(const float* data, int width, int height, int channels) {
   size.x = width;
   size.y = height;
 
@@ -110,5 +112,58 @@ void RenderTexture::loadFromFile(std::string filePath, int channels) {
   glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void RenderTexture::loadPackedFromFiles(const std::vector<std::string>& filePaths,
+                                        const std::vector<unsigned char>& fillValues) {
+  const int channels = filePaths.size();
+  assert((channels == 3 || channels == 4) && fillValues.size() == channels);
+
+  std::vector<unsigned char*> images(channels, nullptr);
+  int width = 0;
+  int height = 0;
+  for (int c = 0; c < channels; c++) {
+    if (filePaths[c].empty()) continue;
+    int x;
+    int y;
+    int n;
+    images[c] = stbi_load(filePaths[c].c_str(), &x, &y, &n, 1);
+    if (images[c] == nullptr || (width != 0 && (x != width || y != height))) {
+      std::cout << "Could not pack " << filePaths[c] << std::endl;
+      stbi_image_free(images[c]);
+      images[c] = nullptr;
+      continue;
+    }
+    width = x;
+    height = y;
+  }
+  if (width == 0) width = height = 1;
+
+  std::vector<unsigned char> packed(width * height * channels);
+  for (int c = 0; c < channels; c++) {
+    for (int i = 0; i < width * height; i++) {
+      packed[i * channels + c] = images[c] != nullptr ? images[c][i] : fillValues[c];
+    }
+    stbi_image_free(images[c]);
+  }
+
+  size.x = width;
+  size.y = height;
+
+  glBindTexture(GL_TEXTURE_2D, ID);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  if (channels == 3) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size.x, size.y, 0, GL_RGB, GL_UNSIGNED_BYTE,
+                 packed.data());
+  } else {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 packed.data());
+  }
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 const unsigned int RenderTexture::getID() const { return ID; }
 }  // namespace procrock
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <string>
+#include <vector>
 
 namespace procrock {
 class RenderTexture {
@@ -11,10 +12,15 @@ class RenderTexture {
   void bind() const;
   void unbind() const;
 
-  void loadFromData(unsigned char* data, int width, int height, int channels = 3);
-  void loadFromData(float* data, int width, int height, int channels = 1);
+  void loadFromData(const unsigned char* data, int width, int height, int channels = 3);
+  void loadFromData(const float* data, int width, int height, int channels = 1);
   void loadFromFile(std::string filePath, int channels = 3);
 
+  // Every file is loaded as one channel of the texture, like the channels of an orm texture.
+  // Channels without a file path get their fill value, all files need the same size.
+  void loadPackedFromFiles(const std::vector<std::string>& filePaths,
+                           const std::vector<unsigned char>& fillValues);
+
   const unsigned int getID() const;
 
  private:
@@ -0,0 +1,31 @@
+#include "allocations.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<long long> allocationCount{0};
+std::atomic<long long> allocatedBytes{0};
+}  // namespace
+
+void* operator new(std::size_t size) {
+  allocationCount++;
+  allocatedBytes += size;
+  void* pointer = std::malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) throw std::bad_alloc();
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+namespace procrock {
+namespace bench {
+void resetAllocationCount() {
+  allocationCount = 0;
+  allocatedBytes = 0;
+}
+
+AllocationCount getAllocationCount() { return AllocationCount{allocationCount, allocatedBytes}; }
+}  // namespace bench
+}  // namespace procrock
@@ -0,0 +1,16 @@
+#pragma once
+
+namespace procrock {
+namespace bench {
+
+// Heap allocations made through new since the last reset, counted by the global operator new
+struct AllocationCount {
+  long long allocations = 0;
+  long long bytes = 0;
+};
+
+void resetAllocationCount();
+AllocationCount getAllocationCount();
+
+}  // namespace bench
+}  // namespace procrock
@@ -0,0 +1,141 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+
+#include "allocations.h"
+
+namespace procrock {
+namespace bench {
+void BenchmarkResult::computeStatistics() {
+  if (samples.empty()) return;
+
+  std::vector<double> sorted = samples;
+  std::sort(sorted.begin(), sorted.end());
+
+  const int count = sorted.size();
+  mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / count;
+  median = count % 2 == 1 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+  p95 = sorted[std::max(0, static_cast<int>(std::ceil(0.95 * count)) - 1)];  // nearest rank
+  min = sorted.front();
+  max = sorted.back();
+}
+
+BenchmarkSuite::BenchmarkSuite(int warmupRuns, int runs)
+    : warmupRuns(std::max(0, warmupRuns)), runs(std::max(1, runs)) {}
+
+void BenchmarkSuite::run(const std::string& name, const std::function<void()>& function,
+                         const std::function<void()>& setup) {
+  if (!isSelected(name)) return;
+  auto& result = getResult(name);
+
+  long long allocations = 0;
+  long long allocatedBytes = 0;
+  for (int i = 0; i < warmupRuns + runs; i++) {
+    if (setup) setup();
+
+    resetAllocationCount();
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+    auto count = getAllocationCount();
+
+    if (i < warmupRuns) continue;
+    result.samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    allocations += count.allocations;
+    allocatedBytes += count.bytes;
+  }
+
+  result.allocations = static_cast<double>(allocations) / runs;
+  result.allocatedBytes = static_cast<double>(allocatedBytes) / runs;
+}
+
+void BenchmarkSuite::addSample(const std::string& name, double milliseconds) {
+  if (!isSelected(name)) return;
+  getResult(name).samples.push_back(milliseconds);
+}
+
+std::vector<BenchmarkResult> BenchmarkSuite::getResults() const {
+  std::vector<BenchmarkResult> finished = results;
+  for (auto& result : finished) {
+    result.computeStatistics();
+  }
+  return finished;
+}
+
+BenchmarkResult& BenchmarkSuite::getResult(const std::string& name) {
+  auto it = resultIndices.find(name);
+  if (it != resultIndices.end()) return results[it->second];
+
+  resultIndices[name] = results.size();
+  results.emplace_back();
+  results.back().name = name;
+  return results.back();
+}
+
+nlohmann::json toJson(const std::vector<BenchmarkResult>& results) {
+  nlohmann::json json = nlohmann::json::array();
+  for (const auto& result : results) {
+    json.push_back(nlohmann::json{{"name", result.name},
+                                  {"mean", result.mean},
+                                  {"median", result.median},
+                                  {"p95", result.p95},
+                                  {"min", result.min},
+                                  {"max", result.max},
+                                  {"allocations", result.allocations},
+                                  {"allocatedBytes", result.allocatedBytes},
+                                  {"samples", result.samples}});
+  }
+  return json;
+}
+
+std::vector<BenchmarkResult> fromJson(const nlohmann::json& json) {
+  std::vector<BenchmarkResult> results;
+  for (const auto& entry : json) {
+    BenchmarkResult result;
+    result.name = entry.at("name").get<std::string>();
+    result.samples = entry.at("samples").get<std::vector<double>>();
+    result.allocations = entry.value("allocations", 0.0);
+    result.allocatedBytes = entry.value("allocatedBytes", 0.0);
+    result.computeStatistics();
+    results.push_back(result);
+  }
+  return results;
+}
+
+int compareResults(const std::vector<BenchmarkResult>& baseline,
+                   const std::vector<BenchmarkResult>& current, double thresholdPercent,
+                   double minimumMilliseconds, std::ostream& output) {
+  std::map<std::string, const BenchmarkResult*> currentByName;
+  for (const auto& result : current) {
+    currentByName[result.name] = &result;
+  }
+
+  int regressions = 0;
+  output << std::fixed << std::setprecision(2);
+  for (const auto& before : baseline) {
+    auto it = currentByName.find(before.name);
+    if (it == currentByName.end()) {
+      output << "  missing     " << before.name << std::endl;
+      continue;
+    }
+
+    const auto& after = *it->second;
+    double difference = after.median - before.median;
+    double percent = before.median > 0 ? difference / before.median * 100 : 0;
+    bool regressed = percent > thresholdPercent && difference > minimumMilliseconds;
+    bool improved = -percent > thresholdPercent && -difference > minimumMilliseconds;
+    if (regressed) regressions++;
+
+    output << (regressed ? "  REGRESSION  " : improved ? "  improved    " : "  ok          ")
+           << before.name << ": " << before.median << "ms -> " << after.median << "ms ("
+           << std::showpos << percent << std::noshowpos << "%)" << std::endl;
+  }
+  output.unsetf(std::ios::floatfield);
+  return regressions;
+}
+}  // namespace bench
+}  // namespace procrock
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace procrock {
+namespace bench {
+
+struct BenchmarkResult {
+  std::string name;
+  std::vector<double> samples;  // milliseconds per measured run
+
+  double mean = 0;
+  double median = 0;
+  double p95 = 0;
+  double min = 0;
+  double max = 0;
+
+  // Per measured run, only known for benchmarks run by the suite itself
+  double allocations = 0;
+  double allocatedBytes = 0;
+
+  void computeStatistics();
+};
+
+class BenchmarkSuite {
+ public:
+  BenchmarkSuite(int warmupRuns, int runs);
+
+  // Calls function warmupRuns + runs times and measures the last runs.
+  // setup is called before every run and is not measured.
+  void run(const std::string& name, const std::function<void()>& function,
+           const std::function<void()>& setup = nullptr);
+
+  // For times measured elsewhere, e.g. the stage times of pipeline profiles
+  void addSample(const std::string& name, double milliseconds);
+
+  // Only benchmarks with the filter text in their name are run, an empty filter runs all
+  inline void setFilter(const std::string& filter) { this->filter = filter; }
+  inline bool isSelected(const std::string& name) const {
+    return name.find(filter) != std::string::npos;
+  }
+
+  inline int getWarmupRuns() const { return warmupRuns; }
+  inline int getRuns() const { return runs; }
+
+  std::vector<BenchmarkResult> getResults() const;
+
+ private:
+  int warmupRuns;
+  int runs;
+  std::string filter;
+
+  std::vector<BenchmarkResult> results;
+  std::map<std::string, int> resultIndices;
+
+  BenchmarkResult& getResult(const std::string& name);
+};
+
+nlohmann::json toJson(const std::vector<BenchmarkResult>& results);
+std::vector<BenchmarkResult> fromJson(const nlohmann::json& json);
+
+// Prints both medians of all benchmarks found in the baseline and the current results.
+// A benchmark regressed if its median got slower by more than thresholdPercent and
+// minimumMilliseconds, the latter keeps timer noise of very short benchmarks out.
+// Returns the amount of regressions.
+int compareResults(const std::vector<BenchmarkResult>& baseline,
+                   const std::vector<BenchmarkResult>& current, double thresholdPercent,
+                   double minimumMilliseconds, std::ostream& output);
+
+}  // namespace bench
+}  // namespace procrock
@@ -0,0 +1,167 @@
+#include <procrocklib/task_pool.h>
+#include <tinydir.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "stage_benchmarks.h"
+
+using namespace procrock::bench;
+
+char* getCmdOption(char** begin, char** end, const std::string& option) {
+  char** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end) {
+    return *itr;
+  }
+  return 0;
+}
+
+void printUsage() {
+  std::cout << "Usage:" << std::endl
+            << "  proc-rock-bench [options]                     run the benchmarks" << std::endl
+            << "  proc-rock-bench --compare <baseline> <result> compare two result files"
+            << std::endl
+            << std::endl
+            << "Options:" << std::endl
+            << "  --files <folder>      parameter files for full pipeline runs (example_files)"
+            << std::endl
+            << "  --size <choice>       texture size, 0 (128x128) to 5 (4096x4096), default 3"
+            << std::endl
+            << "  --warmup <runs>       unmeasured runs before every benchmark, default 1"
+            << std::endl
+            << "  --runs <runs>         measured runs of every benchmark, default 5" << std::endl
+            << "  --filter <text>       only run benchmarks with the text in their name"
+            << std::endl
+            << "  --output <file>       write the results as json" << std::endl
+            << "  --baseline <file>     compare the results with an earlier result file"
+            << std::endl
+            << "  --threshold <percent> slowdown of the median counting as regression, default 10"
+            << std::endl
+            << "  --min-ms <ms>         slowdown in ms needed for a regression, default 1"
+            << std::endl;
+}
+
+std::vector<std::string> getParameterFiles(const std::string& folder) {
+  std::vector<std::string> files;
+
+  tinydir_dir directory;
+  if (tinydir_open(&directory, folder.c_str()) == -1) return files;
+  while (directory.has_next) {
+    tinydir_file file;
+    tinydir_readfile(&directory, &file);
+    if (!file.is_dir && std::string(file.extension) == "json") files.push_back(file.path);
+    tinydir_next(&directory);
+  }
+  tinydir_close(&directory);
+
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+bool loadResults(const std::string& path, std::vector<BenchmarkResult>& results) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cout << "Could not read " << path << std::endl;
+    return false;
+  }
+
+  try {
+    nlohmann::json json;
+    file >> json;
+    results = fromJson(json.at("benchmarks"));
+  } catch (const nlohmann::json::exception& exception) {
+    std::cout << "Could not parse " << path << ": " << exception.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  char** end = argv + argc;
+  if (std::find(argv, end, std::string("--help")) != end) {
+    printUsage();
+    return 0;
+  }
+
+  char* thresholdOption = getCmdOption(argv, end, "--threshold");
+  double threshold = thresholdOption ? std::atof(thresholdOption) : 10;
+  char* minimumOption = getCmdOption(argv, end, "--min-ms");
+  double minimumMilliseconds = minimumOption ? std::atof(minimumOption) : 1;
+
+  // --compare = only compare two earlier result files
+  char* compareOption = getCmdOption(argv, end, "--compare");
+  if (compareOption) {
+    std::vector<BenchmarkResult> baseline, current;
+    char* currentOption = getCmdOption(argv, end, compareOption);
+    if (currentOption == nullptr) {
+      printUsage();
+      return 1;
+    }
+    if (!loadResults(compareOption, baseline) || !loadResults(currentOption, current)) return 1;
+
+    int regressions = compareResults(baseline, current, threshold, minimumMilliseconds, std::cout);
+    std::cout << regressions << " regression(s)" << std::endl;
+    return regressions > 0 ? 1 : 0;
+  }
+
+  char* filesOption = getCmdOption(argv, end, "--files");
+  char* sizeOption = getCmdOption(argv, end, "--size");
+  char* warmupOption = getCmdOption(argv, end, "--warmup");
+  char* runsOption = getCmdOption(argv, end, "--runs");
+  char* filterOption = getCmdOption(argv, end, "--filter");
+  char* outputOption = getCmdOption(argv, end, "--output");
+  char* baselineOption = getCmdOption(argv, end, "--baseline");
+
+  int textureSizeChoice = sizeOption ? std::atoi(sizeOption) : 3;
+  BenchmarkSuite suite(warmupOption ? std::atoi(warmupOption) : 1,
+                       runsOption ? std::atoi(runsOption) : 5);
+  if (filterOption) suite.setFilter(filterOption);
+
+  std::vector<std::string> files = getParameterFiles(filesOption ? filesOption : "example_files");
+  int size = 1 << (textureSizeChoice + 7);
+  std::cout << "Running benchmarks at " << size << "x" << size << " with "
+            << procrock::getTaskPool().getThreadCount() << " threads, " << suite.getWarmupRuns()
+            << " warmup and " << suite.getRuns() << " measured runs, " << files.size()
+            << " parameter files..." << std::endl;
+
+  runStageBenchmarks(suite, textureSizeChoice);
+  runPipelineBenchmarks(suite, files, textureSizeChoice);
+
+  auto results = suite.getResults();
+  for (const auto& result : results) {
+    std::cout << "  " << result.name << ": median " << result.median << "ms, mean "
+              << result.mean << "ms, p95 " << result.p95 << "ms" << std::endl;
+  }
+
+  if (outputOption) {
+    nlohmann::json json{{"textureSize", size},
+                        {"threads", procrock::getTaskPool().getThreadCount()},
+                        {"warmupRuns", suite.getWarmupRuns()},
+                        {"runs", suite.getRuns()},
+                        {"benchmarks", toJson(results)}};
+    std::ofstream file(outputOption);
+    file << json.dump(2);
+    if (!file) std::cout << "Could not write " << outputOption << std::endl;
+  }
+
+  if (baselineOption) {
+    std::vector<BenchmarkResult> baseline;
+    if (!loadResults(baselineOption, baseline)) return 1;
+    baseline.erase(std::remove_if(baseline.begin(), baseline.end(),
+                                  [&](const BenchmarkResult& result) {
+                                    return !suite.isSelected(result.name);
+                                  }),
+                   baseline.end());
+
+    std::cout << std::endl << "Compared to " << baselineOption << ":" << std::endl;
+    int regressions = compareResults(baseline, results, threshold, minimumMilliseconds, std::cout);
+    std::cout << regressions << " regression(s)" << std::endl;
+    return regressions > 0 ? 1 : 0;
+  }
+  return 0;
+}
@@ -0,0 +1,164 @@
+#include "stage_benchmarks.h"
+
+#include <procrocklib/configurables/noise_program.h>
+#include <procrocklib/configurables/texturing.h>
+#include <procrocklib/gen/icosahedron_generator.h>
+#include <procrocklib/mod/decimate_modifier.h>
+#include <procrocklib/mod/subdivision_modifier.h>
+#include <procrocklib/par/xatlas_parameterizer.h>
+#include <procrocklib/pipeline.h>
+#include <procrocklib/texgen/noise_texture_generator.h>
+
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+namespace procrock {
+namespace bench {
+namespace {
+// Hands out a copy of an already parameterized mesh, so only the world map fill is measured
+class PrecomputedParameterizer : public Parameterizer {
+ public:
+  PrecomputedParameterizer(std::shared_ptr<Mesh> uvMesh) : uvMesh(uvMesh) {}
+  virtual PipelineStageInfo& getInfo() override { return info; }
+
+ protected:
+  virtual std::shared_ptr<Mesh> parameterize(Mesh* mesh) override {
+    return std::make_shared<Mesh>(*uvMesh);
+  }
+
+ private:
+  std::shared_ptr<Mesh> uvMesh;
+  PipelineStageInfo info{"Precomputed Parameterizer", "-", PipelineStageType::Parameterizer};
+};
+
+// Blends a prepared texture group onto the textures of the mesh
+class PreparedTextureAdder : public TextureAdder {
+ public:
+  PreparedTextureAdder(TextureGroup addGroup) : TextureAdder(true), addGroup(addGroup) {}
+  virtual PipelineStageInfo& getInfo() override { return info; }
+
+ protected:
+  virtual std::shared_ptr<Mesh> generate(Mesh* before) override {
+    auto result = std::make_shared<Mesh>(*before);
+    addTextures(*result, addGroup);
+    return result;
+  }
+
+ private:
+  TextureGroup addGroup;
+  PipelineStageInfo info{"Prepared Texture Adder", "-", PipelineStageType::TextureAdder};
+};
+
+std::string getFileName(const std::string& path) {
+  std::string name = path.substr(path.find_last_of("/\\") + 1);
+  return name.substr(0, name.rfind('.'));
+}
+}  // namespace
+
+void runStageBenchmarks(BenchmarkSuite& suite, int textureSizeChoice) {
+  IcosahedronGenerator generator;
+  SubdivisionModifier subdivision;
+  subdivision.subdivisions = 4;
+  auto subdivided = subdivision.run(generator.run().get());
+
+  DecimateModifier decimate;
+  suite.run(
+      "stage/decimate", [&]() { decimate.run(subdivided.get()); },
+      [&]() { decimate.setChanged(true); });
+
+  XAtlasParameterizer xatlas;
+  xatlas.textureSizeChoice = textureSizeChoice;
+  suite.run(
+      "stage/xatlas", [&]() { xatlas.run(subdivided.get()); }, [&]() { xatlas.setChanged(true); });
+  xatlas.setChanged(true);
+  auto parameterized = xatlas.run(subdivided.get());
+
+  PrecomputedParameterizer precomputed(parameterized);
+  precomputed.textureSizeChoice = textureSizeChoice;
+  suite.run(
+      "stage/world-map-fill", [&]() { precomputed.run(subdivided.get()); },
+      [&]() { precomputed.setChanged(true); });
+
+  NoiseTextureGenerator textureGenerator;
+  suite.run(
+      "stage/noise-texture-generator", [&]() { textureGenerator.run(parameterized.get()); },
+      [&]() { textureGenerator.setChanged(true); });
+  textureGenerator.setChanged(true);
+  auto textured = textureGenerator.run(parameterized.get());
+
+  TextureGroup addGroup = textured->textures;
+  addGroup.albedoChannels = 4;
+  addGroup.albedoData.write().assign(addGroup.width * addGroup.height * 4, 128);
+  PreparedTextureAdder textureAdder(addGroup);
+  suite.run(
+      "stage/add-textures", [&]() { textureAdder.run(textured.get()); },
+      [&]() { textureAdder.setChanged(true); });
+
+  GradientNormalsGenerator gradientNormals;
+  TextureGroup textures;
+  suite.run(
+      "function/gradient-normals", [&]() { gradientNormals.modify(textures); },
+      [&]() { textures = textured->textures; });
+
+  // Noise graphs evaluated on a single thread, compiled and through the libnoise modules
+  const int pointCount = 1 << 20;
+  std::vector<double> x(pointCount), y(pointCount), z(pointCount), values(pointCount);
+  std::mt19937 random(0);
+  std::uniform_real_distribution<double> distribution(-1, 1);
+  for (int i = 0; i < pointCount; i++) {
+    x[i] = distribution(random);
+    y[i] = distribution(random);
+    z[i] = distribution(random);
+  }
+
+  NoiseGraph noiseGraph;
+  NoiseProgram program(noiseGraph);
+  suite.run("function/noise-compiled",
+            [&]() { program.evaluate(x.data(), y.data(), z.data(), values.data(), pointCount); });
+
+  auto noiseModule = evaluateGraph(noiseGraph);
+  if (noiseModule != nullptr) {
+    suite.run("function/noise-libnoise", [&]() {
+      for (int i = 0; i < pointCount; i++) {
+        values[i] = noiseModule->GetValue(x[i], y[i], z[i]);
+      }
+    });
+  }
+}
+
+void runPipelineBenchmarks(BenchmarkSuite& suite, const std::vector<std::string>& files,
+                           int textureSizeChoice) {
+  for (const auto& file : files) {
+    std::string name = "pipeline/" + getFileName(file);
+    if (!suite.isSelected(name)) continue;
+
+    Pipeline pipeline;
+    pipeline.enableOutput(false);
+    pipeline.setCacheCapacity(0);  // every run should do the full work
+    if (!pipeline.loadFromFile(file)) continue;
+    if (textureSizeChoice >= 0) pipeline.getParameterizer().textureSizeChoice = textureSizeChoice;
+
+    std::vector<PipelineProfile> profiles;
+    suite.run(
+        name,
+        [&]() {
+          pipeline.getCurrentMesh();
+          profiles.push_back(pipeline.getLastProfile());
+        },
+        [&]() { pipeline.getGenerator().setChanged(true); });
+
+    // The first profiles belong to the warmup runs
+    for (int i = suite.getWarmupRuns(); i < profiles.size(); i++) {
+      const auto& stages = profiles[i].stages;
+      for (int stage = 0; stage < stages.size(); stage++) {
+        std::ostringstream stageName;
+        stageName << name << "/" << std::setw(2) << std::setfill('0') << stage << " "
+                  << stages[stage].name;
+        suite.addSample(stageName.str(), stages[stage].wallMs);
+      }
+    }
+  }
+}
+}  // namespace bench
+}  // namespace procrock
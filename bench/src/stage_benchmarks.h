@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+namespace procrock {
+namespace bench {
+
+// Single stages and texture functions on a subdivided icosahedron, every benchmark gets the
+// same input mesh on every run
+void runStageBenchmarks(BenchmarkSuite& suite, int textureSizeChoice);
+
+// Full pipeline runs of every parameter file, records the whole run and every stage of it.
+// A negative texture size choice keeps the sizes of the files.
+void runPipelineBenchmarks(BenchmarkSuite& suite, const std::vector<std::string>& files,
+                           int textureSizeChoice);
+
+}  // namespace bench
+}  // namespace procrock
@@ -1,9 +1,24 @@
+#include <procrocklib/configurables/noise_program.h>
 #include <procrocklib/pipeline.h>
 #include <tinydir.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 char* getCmdOption(char** begin, char** end, const std::string& option) {
   char** itr = std::find(begin, end, option);
@@ -17,8 +32,134 @@ bool cmdOptionExists(char** begin, char** end, const std::string& option) {
   return std::find(begin, end, option) != end;
 }
 
+void makeDirectory(const std::string& path) {
+#ifdef _WIN32
+  _mkdir(path.c_str());
+#else
+  mkdir(path.c_str(), 0755);
+#endif
+}
+
+void writeTextFile(const std::string& path, const std::string& content) {
+  std::ofstream file(path);
+  file << content;
+  if (!file) std::cout << "Could not write " << path << std::endl;
+}
+
+void printProfile(const procrock::PipelineProfile& profile) {
+  for (const auto& stage : profile.stages) {
+    std::cout << "  " << std::left << std::setw(34)
+              << std::string(procrock::getStageTypeName(stage.type)) + ": " + stage.name
+              << std::right << std::setw(9) << std::fixed << std::setprecision(1)
+              << stage.wallMs << "ms wall" << std::setw(9) << stage.processCpuMs
+              << "ms process cpu" << std::setw(8) << stage.processPeakMemory / (1024.0 * 1024.0)
+              << "MB process peak, "
+              << stage.outputVertices << " vertices, " << stage.outputFaces << " faces"
+              << std::endl;
+  }
+  std::cout.unsetf(std::ios::floatfield);
+}
+
+// Runs all parameter files in a folder on several workers, each with its own pipeline.
+// Every rock is exported to <outputFolder>/<file name>/<file name>.obj
+void runBatch(const std::string& batchFolder, const std::string& outputFolder, int jobs) {
+  std::vector<std::pair<std::string, std::string>> files;  // path and name without extension
+
+  tinydir_dir directory;
+  tinydir_open(&directory, batchFolder.c_str());
+  while (directory.has_next) {
+    tinydir_file file;
+    tinydir_readfile(&directory, &file);
+
+    if (!file.is_dir && std::string(file.extension) == "json") {
+      std::string name = file.name;
+      files.emplace_back(file.path, name.substr(0, name.rfind('.')));
+    }
+    tinydir_next(&directory);
+  }
+  tinydir_close(&directory);
+
+  std::sort(files.begin(), files.end());
+  makeDirectory(outputFolder);
+
+  std::cout << "Generating " << files.size() << " rocks with " << jobs << " jobs..." << std::endl;
+
+  std::atomic<int> nextFile{0};
+  std::atomic<int> finished{0};
+  std::atomic<int> failed{0};
+  std::mutex outputMutex;
+
+  auto worker = [&]() {
+    procrock::Pipeline pipeline;
+    pipeline.enableOutput(false);
+
+    for (int i = nextFile++; i < files.size(); i = nextFile++) {
+      const auto& file = files[i];
+      auto start = std::chrono::high_resolution_clock::now();
+
+      // A file that makes a stage or the export throw only fails itself, not the whole batch
+      std::string error;
+      try {
+        if (pipeline.loadFromFile(file.first)) {
+          std::string rockFolder = outputFolder + "/" + file.second;
+          makeDirectory(rockFolder);
+
+          pipeline.getCurrentMesh();
+          procrock::Pipeline::ExportSettings settings;
+          pipeline.exportCurrent(rockFolder + "/" + file.second + ".obj", settings);
+        } else {
+          error = "could not read the file";
+        }
+      } catch (const std::exception& e) {
+        error = e.what();
+      } catch (...) {
+        error = "unknown error";
+      }
+
+      auto end = std::chrono::high_resolution_clock::now();
+      auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+      std::lock_guard<std::mutex> lock(outputMutex);
+      if (error.empty()) {
+        std::cout << "[" << ++finished << "/" << files.size() << "] " << file.first << ": "
+                  << duration.count() << "ms" << std::endl;
+      } else {
+        failed++;
+        std::cout << "Failed " << file.first << ": " << error << std::endl;
+      }
+    }
+  };
+
+  auto start = std::chrono::high_resolution_clock::now();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < jobs; i++) {
+    threads.emplace_back(worker);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto end = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+
+  std::cout << std::endl << "Batch finished." << std::endl;
+  std::cout << "Rocks generated: " << finished << ", failed: " << failed << std::endl;
+  std::cout << "Total time: " << seconds << "s" << std::endl;
+  if (seconds > 0) {
+    std::cout << "Throughput: " << finished * 60.0 / seconds << " rocks/minute" << std::endl;
+  }
+}
+
 int main(int argc, char* argv[]) {
+  // --interpreted-noise = evaluate noise graphs module by module through libnoise
+  if (cmdOptionExists(argv, argv + argc, "--interpreted-noise")) {
+    procrock::setNoiseCompilationEnabled(false);
+  }
+
   // -r = run a parameter file and export in place
+  // --profile = write the stage timings of the run to a json file
+  // --trace = write the stage timings of the run as chrome trace
   char* parameterFile = getCmdOption(argv, argv + argc, "-r");
   if (parameterFile) {
     procrock::Pipeline pipeline;
@@ -26,6 +167,11 @@ int main(int argc, char* argv[]) {
     pipeline.loadFromFile(parameterFile);
     pipeline.getCurrentMesh();
 
+    char* profileFile = getCmdOption(argv, argv + argc, "--profile");
+    if (profileFile) writeTextFile(profileFile, pipeline.getLastProfile().toJson());
+    char* traceFile = getCmdOption(argv, argv + argc, "--trace");
+    if (traceFile) writeTextFile(traceFile, pipeline.getLastProfile().toChromeTrace());
+
     procrock::Pipeline::ExportSettings settings;
     pipeline.exportCurrent("output.obj", settings);
   }
@@ -36,6 +182,7 @@ int main(int argc, char* argv[]) {
   if (benchmarkFolder) {
     procrock::Pipeline pipeline;
     pipeline.enableOutput(false);
+    pipeline.setCacheCapacity(0);  // every run should do the full work
 
     tinydir_dir directory;
     tinydir_open(&directory, benchmarkFolder);
@@ -74,6 +221,7 @@ int main(int argc, char* argv[]) {
         int res = std::pow(2, i + 7);
         std::cout << res << "x" << res << ": " << durationSum / 3 << "ms";
         std::cout << std::endl;
+        printProfile(pipeline.getLastProfile());
       }
       std::cout << std::endl;
       tinydir_next(&directory);
@@ -82,5 +230,20 @@ int main(int argc, char* argv[]) {
     tinydir_close(&directory);
   }
 
+  // --batch = generate and export all parameter files of a folder in parallel
+  // --jobs = amount of independent pipelines working at the same time
+  // --output = folder to put the results in, one sub folder per file
+  char* batchFolder = getCmdOption(argv, argv + argc, "--batch");
+  if (batchFolder) {
+    int jobs = std::max(1u, std::thread::hardware_concurrency());
+    char* jobsOption = getCmdOption(argv, argv + argc, "--jobs");
+    if (jobsOption) jobs = std::max(1, std::atoi(jobsOption));
+
+    char* outputOption = getCmdOption(argv, argv + argc, "--output");
+    std::string outputFolder = outputOption ? outputOption : "batch-output";
+
+    runBatch(batchFolder, outputFolder, jobs);
+  }
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+
+namespace procrock {
+
+// Thrown at cancellation checkpoints once the current token was cancelled
+class OperationCancelled : public std::exception {
+ public:
+  virtual const char* what() const noexcept override { return "Operation cancelled"; }
+};
+
+class CancellationToken {
+ public:
+  inline void cancel() { cancelled = true; }
+  inline bool isCancelled() const { return cancelled; }
+
+ private:
+  std::atomic<bool> cancelled{false};
+};
+
+// Makes the token the current one of the calling thread while the scope lives.
+// Tasks of the task pool take over the token of the thread that started them.
+class CancellationScope {
+ public:
+  CancellationScope(CancellationToken* token);
+  ~CancellationScope();
+
+  CancellationScope(const CancellationScope&) = delete;
+  CancellationScope& operator=(const CancellationScope&) = delete;
+
+ private:
+  CancellationToken* previous;
+};
+
+// nullptr if the calling thread runs outside of any cancellation scope
+CancellationToken* getCurrentCancellationToken();
+
+// Cancellation checkpoint, throws OperationCancelled if the current token was cancelled
+void throwIfCancelled();
+
+}  // namespace procrock
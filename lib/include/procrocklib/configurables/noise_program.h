@@ -0,0 +1,85 @@
+#pragma once
+
+#include <procrocklib/configurables/noise_graph.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace procrock {
+
+// A noise graph flattened into a linear list of instructions working on register slots.
+// Every instruction processes a whole block of positions, so evaluating many points only costs
+// one dispatch per node and block instead of a chain of virtual calls per point.
+class NoiseProgram {
+ public:
+  NoiseProgram(const NoiseGraph& noiseGraph);
+
+  // True if the graph has no root node, evaluating it yields 0 everywhere
+  inline bool isEmpty() const { return instructions.empty(); }
+
+  // Evaluates the graph at count positions given as separate coordinate arrays
+  void evaluate(const double* x, const double* y, const double* z, double* out, int count) const;
+
+  // Positions are processed in blocks of this size
+  static const int blockSize = 256;
+
+ private:
+  enum class OpCode {
+    Const,
+    Perlin,
+    Billow,
+    Ridged,
+    Voronoi,
+    Spheres,
+    Cylinders,
+    Add,
+    Max,
+    Min,
+    Multiply,
+    Power,
+    Blend,
+    Select,
+    Abs,
+    Clamp,
+    Exponent,
+    Invert,
+    ScaleBias,
+    Terrace,
+    Curve,
+    // Coordinate transformations, they write three registers starting at target
+    ScalePoint,
+    TranslatePoint,
+    RotatePoint,
+    DisplacePoint
+  };
+
+  struct Instruction {
+    OpCode op;
+    int target = -1;
+    int coords = -1;  // first of the three registers holding the x, y, z coordinates
+    int sources[3] = {-1, -1, -1};
+    double params[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+    int intParams[2] = {0, 0};
+    std::vector<std::pair<double, double>> controlPoints;  // terrace and curve nodes
+  };
+
+  std::vector<Instruction> instructions;
+  int registerCount = 3;  // the first three registers hold the input positions
+  int resultRegister = -1;
+
+  // Inputs of every node in the order libnoise source modules would be set by evaluateGraph
+  std::map<int, std::vector<int>> nodeSources;
+  std::map<std::pair<int, int>, int> compiledNodes;  // (node, coords) -> register
+
+  int compileNode(const NoiseGraph& noiseGraph, int nodeId, int coords);
+  int addInstruction(Instruction instruction, int targetRegisters = 1);
+  void execute(const Instruction& instruction, double* registers, int count) const;
+};
+
+// The texture stages use compiled noise programs unless this is switched off,
+// e.g. to compare against the plain libnoise evaluation.
+void setNoiseCompilationEnabled(bool enabled);
+bool isNoiseCompilationEnabled();
+
+}  // namespace procrock
@@ -14,6 +14,16 @@ class TextureGroupModifier : public ConfigurableExtender {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) = 0;
   virtual void modify(TextureGroup& textureGroup) = 0;
+
+  // TextureGroup::Channel flags of the channels modify reads
+  virtual int getSourceChannels() const { return TextureGroup::AllChannels; }
+
+  // Modifiers working texel by texel can also run tile by tile, so several of them share one
+  // pass over the texture while a tile is still in cache. prepareTiles sets up the output
+  // channels, afterwards modifyTile is called once per tile, possibly from several threads.
+  virtual bool isTileable() const { return false; }
+  virtual void prepareTiles(TextureGroup& textureGroup) {}
+  virtual void modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) {}
 };
 
 // Albedo
@@ -24,6 +34,10 @@ class GradientAlphaAlbedoGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
+  virtual bool isTileable() const override;
+  virtual void prepareTiles(TextureGroup& textureGroup) override;
+  virtual void modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) override;
 
   GradientAlphaColoring coloring;
 };
@@ -36,6 +50,10 @@ class AlbedoAlphaGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
+  virtual bool isTileable() const override;
+  virtual void prepareTiles(TextureGroup& textureGroup) override;
+  virtual void modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) override;
 
  private:
   std::vector<std::unique_ptr<TextureGroupModifier>> methods;
@@ -49,6 +67,10 @@ class GradientAlbedoGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
+  virtual bool isTileable() const override;
+  virtual void prepareTiles(TextureGroup& textureGroup) override;
+  virtual void modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) override;
 
   GradientColoring coloring;
 };
@@ -60,6 +82,7 @@ class NoiseGradientAlbedoGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
 
   NoiseGraph noiseGraph;
   GradientColoring coloring;
@@ -73,6 +96,10 @@ class AlbedoGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
+  virtual bool isTileable() const override;
+  virtual void prepareTiles(TextureGroup& textureGroup) override;
+  virtual void modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) override;
 
  private:
   std::vector<std::unique_ptr<TextureGroupModifier>> methods;
@@ -87,6 +114,7 @@ class GradientNormalsGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
 
   float normalStrength = 1.4f;
   // 0 = Backward finite differences, 1 = Centered finite differences, 2 = Forward finite
@@ -104,6 +132,7 @@ class NormalsGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
 
  private:
   std::vector<std::unique_ptr<TextureGroupModifier>> methods;
@@ -118,6 +147,10 @@ class GreyscaleRoughnessGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
+  virtual bool isTileable() const override;
+  virtual void prepareTiles(TextureGroup& textureGroup) override;
+  virtual void modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) override;
 
   float scaling = 2.0f;
   int bias = 0;
@@ -133,6 +166,10 @@ class RoughnessGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
+  virtual bool isTileable() const override;
+  virtual void prepareTiles(TextureGroup& textureGroup) override;
+  virtual void modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) override;
 
  private:
   std::vector<std::unique_ptr<TextureGroupModifier>> methods;
@@ -147,6 +184,10 @@ class GreyscaleMetalnessGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
+  virtual bool isTileable() const override;
+  virtual void prepareTiles(TextureGroup& textureGroup) override;
+  virtual void modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) override;
 
   float scaling = 0.2f;
   int bias = 0;
@@ -166,6 +207,10 @@ class MetalnessGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
+  virtual bool isTileable() const override;
+  virtual void prepareTiles(TextureGroup& textureGroup) override;
+  virtual void modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) override;
 
  private:
   std::vector<std::unique_ptr<TextureGroupModifier>> methods;
@@ -180,6 +225,10 @@ class GreyscaleAmbientOcclusionGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
+  virtual bool isTileable() const override;
+  virtual void prepareTiles(TextureGroup& textureGroup) override;
+  virtual void modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) override;
 
   float scaling = 0.5f;
   int bias = 0;
@@ -195,6 +244,10 @@ class AmbientOcclusionGenerator : public TextureGroupModifier {
       Configuration& config, std::string newGroupName,
       std::function<bool()> activeFunc = []() { return true; }) override;
   virtual void modify(TextureGroup& textureGroup) override;
+  virtual int getSourceChannels() const override;
+  virtual bool isTileable() const override;
+  virtual void prepareTiles(TextureGroup& textureGroup) override;
+  virtual void modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) override;
 
  private:
   std::vector<std::unique_ptr<TextureGroupModifier>> methods;
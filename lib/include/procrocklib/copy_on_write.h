@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+
+namespace procrock {
+
+// Holds a value which is shared between copies until one of them is written to.
+// Reading goes through ->, * or read(), writing through write() which copies the value first if
+// another copy still refers to it. References returned by write() are only valid until the
+// holder is copied again.
+template <typename T>
+class CopyOnWrite {
+ public:
+  CopyOnWrite() = default;
+  CopyOnWrite(T value) : value(std::make_shared<T>(std::move(value))) {}
+
+  inline const T& read() const { return value == nullptr ? getEmpty() : *value; }
+  inline const T& operator*() const { return read(); }
+  inline const T* operator->() const { return &read(); }
+
+  inline T& write() {
+    if (value == nullptr) {
+      value = std::make_shared<T>();
+    } else if (value.use_count() > 1) {
+      value = std::make_shared<T>(*value);
+    }
+    return *value;
+  }
+
+  // Replaces the value without copying the old one
+  inline T& reset(T newValue = T()) {
+    value = std::make_shared<T>(std::move(newValue));
+    return *value;
+  }
+
+  inline bool isShared() const { return value != nullptr && value.use_count() > 1; }
+
+ private:
+  std::shared_ptr<T> value;  // nullptr stands for a default constructed value
+
+  static const T& getEmpty() {
+    static const T empty{};
+    return empty;
+  }
+};
+}  // namespace procrock
@@ -1,11 +1,31 @@
 #pragma once
 
 #include <procrocklib/mesh.h>
+#include <procrocklib/texture_packing.h>
 
 #include <string>
+#include <vector>
 
 namespace procrock {
+// File format of the displacement channel. Bytes are written like the other textures, as png or
+// dds. The others keep more of the height, as 16 bit png or as 32 bit floats in an exr file or a
+// raw file without header.
+enum class DisplacementFormat { Bytes, Png16, Exr, RawFloats };
+
+// Writes an obj file with one texture file per channel next to it. With a packing, the channels
+// in it share one texture instead.
 void exportMesh(Mesh& mesh, const std::string filepath, bool albedo = true, bool normals = true,
                 bool roughness = true, bool metal = true, bool displace = true,
-                bool ambientOcc = true);
+                bool ambientOcc = true, int compressionLevel = 6,
+                bool compressTextures = false, bool albedoBC7 = true,
+                const ChannelPacking* packing = nullptr,
+                DisplacementFormat displacementFormat = DisplacementFormat::Bytes);
+
+// Writes the levels of detail, most detailed first, into one binary gltf file. Their nodes are
+// named rock_LOD0, rock_LOD1 and so on, a single mesh is just rock.
+// The textures are embedded as pngs, ambient occlusion, roughness and metal packed into one the
+// way gltf reads them. Gltf has no displacement, so it is left out.
+void exportGlb(const std::vector<Mesh>& lods, const std::string filepath, bool albedo = true,
+               bool normals = true, bool roughness = true, bool metal = true,
+               bool ambientOcc = true, int compressionLevel = 6);
 }
\ No newline at end of file
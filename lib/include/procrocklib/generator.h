@@ -17,6 +17,7 @@ class Generator : public PipelineStage {
   virtual bool isRemovable() const override;
 
   inline bool isFirstRun() const { return firstRun; }
+  inline void setFirstRun(bool firstRun) { this->firstRun = firstRun; }
 
  protected:
   virtual std::shared_ptr<Mesh> generate() = 0;
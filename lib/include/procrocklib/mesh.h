@@ -2,6 +2,8 @@
 #include <procrocklib/texture.h>
 
 #include <Eigen/Core>
+#include <cstddef>
+#include <vector>
 
 namespace procrock {
 struct Mesh {
@@ -12,6 +14,13 @@ struct Mesh {
   Eigen::MatrixXd faceNormals;
   Eigen::MatrixXd uvs;
 
+  // Tangent space of every face with the normalized tangent, bitangent and normal as columns,
+  // filled by the parameterizer together with the face tangents
+  std::vector<Eigen::Matrix3f> faceFrames;
+
   TextureGroup textures;
+
+  // Identifies the stages and configurations this mesh was created by, used for caching
+  std::size_t hash = 0;
 };
 }  // namespace procrock
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+#include <procrocklib/mesh.h>
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace procrock {
+
+// Bounded least recently used cache of pipeline stage results.
+// Keys are computed by the stages from their configuration and their input mesh. Next to every
+// key the cache keeps the identity it was computed from, e.g. the serialized configuration, and
+// only returns an entry if that matches too. So two colliding keys never share a result.
+class MeshCache {
+ public:
+  MeshCache(int capacity = 4);
+
+  // Returns nullptr if there is no entry for the key and identity.
+  std::shared_ptr<Mesh> get(std::size_t key, const std::string& identity);
+  // Replaces an entry with the same key, even if its identity differs
+  void insert(std::size_t key, const std::string& identity, std::shared_ptr<Mesh> mesh);
+
+  // A capacity of 0 disables the cache.
+  void setCapacity(int capacity);
+  inline int getCapacity() const { return capacity; }
+  inline int getSize() const { return entries.size(); }
+
+  void clear();
+
+ private:
+  struct CacheEntry {
+    std::size_t key;
+    std::string identity;
+    std::shared_ptr<Mesh> mesh;
+  };
+
+  int capacity;
+  std::list<CacheEntry> entries;  // most recently used first
+  std::unordered_map<std::size_t, std::list<CacheEntry>::iterator> lookup;
+};
+}  // namespace procrock
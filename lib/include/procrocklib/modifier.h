@@ -13,6 +13,7 @@ class Modifier : public PipelineStage, public Disablable {
   virtual bool isRemovable() const override;
 
   inline bool isFirstRun() const { return firstRun; }
+  inline void setFirstRun(bool firstRun) { this->firstRun = firstRun; }
 
  protected:
   virtual std::shared_ptr<Mesh> modify(Mesh& mesh) = 0;
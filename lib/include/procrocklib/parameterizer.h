@@ -12,33 +12,42 @@ class Parameterizer : public PipelineStage {
 
   int textureSizeChoice = 2;
 
+  // Single sample, 2x2 rotated grid, 3x3 grid or adaptive 3x3 grid
+  int samplingChoice = 2;
+  float adaptiveThreshold = 0.02f;
+
   virtual std::shared_ptr<Mesh> run(Mesh* before = nullptr) override;
 
   virtual bool isMoveable() const override;
   virtual bool isRemovable() const override;
 
   inline bool isFirstRun() const { return firstRun; }
+  inline void setFirstRun(bool firstRun) { this->firstRun = firstRun; }
 
  protected:
   virtual std::shared_ptr<Mesh> parameterize(Mesh* mesh) = 0;
   void setTextureGroupSize(Mesh& mesh);
+  void setSamplingPattern(Mesh& mesh);
   void fillTextureMapFaceBased(Mesh& mesh);
 
  private:
   std::shared_ptr<Mesh> mesh;
   bool firstRun = true;
-  struct TextureMapPatch {
-    int face;
-    Eigen::Vector3f faceTangent;
-    int x, y, height, width;
-    std::vector<TextureGroup::WorldMapEntry> worldMap;
-  };
 
-  static void fillTextureMapPatches(int startIndex, int endIndex,
-                                    std::vector<TextureMapPatch>& result, const Mesh& mesh);
+  // Where a face lies in the texture and how its uvs map to barycentric coordinates
+  struct FaceRaster {
+    TextureGroup::Tile bounds;  // uv bounding box of the face in texels
+    double minU, minV;          // uv of the bounding box corner
+    bool degenerate;            // the uvs span no area, no texel lies inside
+    Eigen::Matrix2d uvToBarycentric;
+    Eigen::Vector2d uvOrigin;  // uv of the face's first corner
+    TextureGroup::WorldMap::FaceTransform transform;
+  };
 
-  static void fillTextureMapPatch(TextureMapPatch& patch, const Mesh& mesh);
-  void applyTextureMapPatches(Mesh& mesh, const std::vector<TextureMapPatch>& patches);
+  static FaceRaster setupFaceRaster(int face, const Mesh& mesh);
+  static void setFaceFrame(Mesh& mesh, int face);
+  static void rasterizeFace(int face, const FaceRaster& raster, const TextureGroup::Tile& tile,
+                            TextureGroup::WorldMap& worldMap);
 };
 
 }  // namespace procrock
\ No newline at end of file
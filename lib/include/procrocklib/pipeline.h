@@ -1,12 +1,19 @@
 #pragma once
+#include <procrocklib/export.h>
 #include <procrocklib/generator.h>
+#include <procrocklib/mod/decimate_modifier.h>
 #include <procrocklib/modifier.h>
 #include <procrocklib/parameterizer.h>
+#include <procrocklib/profiling.h>
 #include <procrocklib/texture_adder.h>
 #include <procrocklib/texture_generator.h>
+#include <procrocklib/texture_packing.h>
 
+#include <chrono>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <utility>
 
 namespace procrock {
 class Generator;
@@ -35,18 +42,43 @@ class Pipeline {
   void removePipelineStage(PipelineStage* stage);
 
   const std::shared_ptr<Mesh> getCurrentMesh();
+  // Timings and sizes of every stage during the last getCurrentMesh call
+  const PipelineProfile& getLastProfile() const;
 
   void clear();
 
+  // Decimates the output of the modifiers to about this many faces before it is parameterized,
+  // for fast previews. The modifiers and their results stay as they are, 0 turns it off.
+  void setPreviewFaceCount(int faceCount);
+
   bool isChanged();
+  // Clears the change flags of all stages without running them. Only meant for pipelines which
+  // are edited here but run elsewhere from snapshots, e.g. by a PipelineExecutor.
+  void markUnchanged();
+
+  // Every stage position keeps this many recent results, 0 disables caching
+  void setCacheCapacity(int capacity);
+  void clearCache();
 
   void enableOutput(bool enable);
   void setOutputStream(std::ostream* stream);
 
   void saveToFile(const std::string filePath);
-  void loadFromFile(const std::string filePath);
+  // Returns false if the file could not be read
+  bool loadFromFile(const std::string filePath);
+
+  // Same as the file versions, with the json content in a string
+  std::string saveToString();
+  bool loadFromString(const std::string& content);
+  // Same as loadFromString, but stages of the same type in the same place are kept. Only the
+  // ones whose configuration differs get it filled in and are marked as changed, so just those
+  // and the stages after them run again.
+  bool updateFromString(const std::string& content);
 
   struct ExportSettings {
+    // One binary gltf file with all levels of detail and embedded textures instead of obj files
+    bool exportGlb = false;
+
     bool exportLODs = false;
     int lodCount = 3;
     bool lodTextures = false;
@@ -57,6 +89,27 @@ class Pipeline {
     bool exportMetal = true;
     bool exportDisplacement = true;
     bool exportAmbientOcc = true;
+
+    // Texels outside of the uv islands are filled from the islands up to this distance,
+    // 0 leaves them as they are
+    int texturePadding = 16;
+
+    // Png compression from 0 (fastest) to 9 (smallest files)
+    int compressionLevel = 6;
+
+    // Block compressed dds files with mip maps instead of pngs. Albedo goes to BC7 or BC1,
+    // normals to BC5 and the single channels to BC4.
+    bool compressTextures = false;
+    bool albedoBC7 = true;
+
+    // Channels of the packing go into one texture instead of a file each, glb files always pack
+    // the orm layout
+    bool packTextures = false;
+    ChannelPacking packing = ChannelPacking::orm();
+
+    // Higher precision formats for the displacement, which is used as a height map. Any but
+    // bytes are written as they are, even when the other textures are block compressed.
+    DisplacementFormat displacementFormat = DisplacementFormat::Bytes;
   };
 
   void exportCurrent(const std::string filePath, ExportSettings settings);
@@ -70,6 +123,23 @@ class Pipeline {
 
   std::shared_ptr<Mesh> currentMesh;
 
+  PipelineProfile lastProfile;
+  std::chrono::steady_clock::time_point profileStart;
+  std::shared_ptr<Mesh> runProfiled(PipelineStage& stage, Mesh* before, bool changed);
+
+  std::unique_ptr<DecimateModifier> previewDecimation;  // nullptr without a preview face count
+
+  // One cache per stage position, so the stages of a type never evict each other's results.
+  // The parts of a result, at most one per texture channel, are kept for as many results.
+  struct StageCaches {
+    MeshCache results;
+    MeshCache parts;
+  };
+  int cacheCapacity = 4;
+  static const int partsPerResult = 6;
+  std::map<std::pair<PipelineStageType, int>, StageCaches> stageCaches;
+  void setStageCaches(PipelineStage& stage, int position = 0);
+
   bool outputEnabled = true;
   std::ostream* outputStream = &std::cout;
 };
@@ -0,0 +1,86 @@
+#pragma once
+#include <procrocklib/cancellation.h>
+#include <procrocklib/pipeline.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace procrock {
+
+// Runs pipelines on a background thread, from snapshots made with Pipeline::saveToString.
+// A new snapshot supersedes all earlier ones, a run of an outdated snapshot is cancelled at its
+// next cancellation checkpoint. The executor keeps one pipeline for all snapshots and only
+// updates the stages whose configuration differs, so like in a pipeline edited in place just
+// those and the stages after them run again.
+//
+// In progressive mode every snapshot is run at a few texture sizes, starting with a small preview
+// of a decimated mesh. Each pass is handed out as a result once it is done.
+class PipelineExecutor {
+ public:
+  PipelineExecutor();
+  ~PipelineExecutor();
+
+  void submit(const std::string& snapshot);
+  // Takes effect with the next snapshot
+  void setProgressive(bool progressive);
+  // Exports the result of the latest snapshot once it is done
+  void submitExport(const std::string& filePath, Pipeline::ExportSettings settings);
+
+  struct Result {
+    std::shared_ptr<Mesh> mesh;
+    PipelineProfile profile;
+    bool preview = false;  // a refined result follows
+  };
+
+  // Hands out the newest finished result, if there is one that was not taken yet
+  bool takeResult(Result& result);
+
+  // True while snapshots or exports are queued or running
+  bool isBusy();
+  bool isExporting();
+
+  // Message of the last run that failed, empty if the last run succeeded
+  std::string getLastError();
+
+ private:
+  // Texture size choices of the preview passes, the ones below the target size are run
+  static const int previewTextureSizeChoices[3];
+  // Face count of the first preview pass
+  static const int previewFaceCount = 5000;
+
+  Pipeline pipeline;  // only used by the worker thread, updated from every snapshot
+  bool snapshotLoaded = false;
+  std::thread worker;
+
+  std::mutex mutex;
+  std::condition_variable wakeUp;
+  bool stopping = false;
+
+  bool snapshotPending = false;
+  std::string pendingSnapshot;
+  bool progressive = true;
+  std::shared_ptr<CancellationToken> runningToken;  // of the run in progress
+
+  struct ExportJob {
+    std::string filePath;
+    Pipeline::ExportSettings settings;
+  };
+  std::vector<ExportJob> pendingExports;
+  bool running = false;
+  bool exporting = false;
+
+  bool resultReady = false;
+  Result result;
+  std::string lastError;
+
+  void workerLoop();
+  void runSnapshot(const std::string& snapshot, CancellationToken& token, bool progressive);
+  std::shared_ptr<Mesh> runPass(int textureSizeChoice, bool decimate);
+  void publishResult(std::shared_ptr<Mesh> mesh, bool preview);
+};
+
+}  // namespace procrock
@@ -1,7 +1,9 @@
 #pragma once
 #include <procrocklib/configurable.h>
 #include <procrocklib/mesh.h>
+#include <procrocklib/mesh_cache.h>
 
+#include <functional>
 #include <memory>
 
 namespace procrock {
@@ -38,6 +40,30 @@ class PipelineStage : public Configurable {
     oss << (void*)this;
     return getInfo().name + "##(" + oss.str() + ")";
   }
+
+  // Results are looked up in and stored to this cache, nullptr disables caching
+  inline void setMeshCache(MeshCache* meshCache) { this->meshCache = meshCache; }
+  // Same for parts of a result that only depend on some of the settings, see runCachedPart
+  inline void setPartCache(MeshCache* partCache) { this->partCache = partCache; }
+  // If the result of the last computation came from the cache
+  inline bool wasCacheHit() const { return cacheHit; }
+
+ protected:
+  // Returns the cached result for the current configuration and input or computes and caches it
+  std::shared_ptr<Mesh> runCached(Mesh* before, std::function<std::shared_ptr<Mesh>()> compute);
+  // Same for a part of the result, e.g. the uv layout without the texture maps. The identity has
+  // to describe everything the part is computed from, including the input.
+  std::shared_ptr<Mesh> runCachedPart(const std::string& identity,
+                                      std::function<std::shared_ptr<Mesh>()> compute);
+  // Lookup and insertion on their own, for parts computed together. Returns nullptr if there is
+  // no part with the identity.
+  std::shared_ptr<Mesh> getCachedPart(const std::string& identity);
+  void cachePart(const std::string& identity, std::shared_ptr<Mesh> part);
+
+ private:
+  MeshCache* meshCache = nullptr;
+  MeshCache* partCache = nullptr;
+  bool cacheHit = false;
 };
 
 class Disablable {
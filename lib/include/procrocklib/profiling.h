@@ -0,0 +1,57 @@
+#pragma once
+#include <procrocklib/pipeline_stage.h>
+
+#include <string>
+#include <vector>
+
+namespace procrock {
+
+// Measurements of one stage during a pipeline run
+struct StageProfile {
+  std::string name;
+  PipelineStageType type = PipelineStageType::NoType;
+
+  // Unchanged stages reuse their last result, cached stages got it from the mesh cache
+  enum class Result { Computed, Cached, Unchanged };
+  Result result = Result::Computed;
+
+  double startMs = 0;  // relative to the start of the pipeline run
+  double wallMs = 0;
+
+  // The operating system only reports cpu time and peak memory for the whole process. They
+  // include every other thread, e.g. other batch workers or the app's render thread, and are not
+  // figures of the stage alone.
+  double processCpuMs = 0;  // cpu time of the process during the stage
+  // Highest resident memory of the process so far, taken when the stage is done. It only grows,
+  // a stage that needed more than all before it shows as a step.
+  long long processPeakMemory = 0;
+
+  int inputVertices = 0;
+  int inputFaces = 0;
+  int outputVertices = 0;
+  int outputFaces = 0;
+  unsigned int textureWidth = 0;
+  unsigned int textureHeight = 0;
+};
+
+struct PipelineProfile {
+  std::vector<StageProfile> stages;
+  double wallMs = 0;
+  double processCpuMs = 0;
+
+  std::string toJson() const;
+  // Can be opened in chrome://tracing or https://ui.perfetto.dev
+  std::string toChromeTrace() const;
+};
+
+const char* getStageTypeName(PipelineStageType type);
+const char* getStageResultName(StageProfile::Result result);
+
+namespace profiling {
+// Cpu time of the process in all its threads
+double getCpuTimeMs();
+// Peak resident memory of the process since it started, in bytes
+long long getPeakMemory();
+}  // namespace profiling
+
+}  // namespace procrock
@@ -0,0 +1,119 @@
+#pragma once
+#include <procrocklib/cancellation.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace procrock {
+
+// Persistent worker threads shared by the whole library.
+// Every worker owns a queue of tasks, takes new work from its back and steals from the front of
+// other queues when it runs dry. Threads waiting for their tasks to finish help out meanwhile.
+class TaskPool {
+ public:
+  // A thread count of 0 uses one thread per hardware thread, the calling thread counts as one
+  TaskPool(int threadCount = 0);
+  ~TaskPool();
+
+  // Must not be called while tasks are running
+  void setThreadCount(int threadCount = 0);
+  inline int getThreadCount() const { return workers.size() + 1; }
+
+  // Calls function(rangeBegin, rangeEnd) for disjoint sub ranges covering [begin, end).
+  // Ranges are split in halves down to grainSize, idle threads steal the larger halves.
+  // The first exception thrown by a range is rethrown here after all ranges are done.
+  // Ranges run with the cancellation token of the calling thread and are skipped once it is
+  // cancelled, OperationCancelled is thrown then.
+  template <typename Function>
+  void parallelFor(int begin, int end, int grainSize, const Function& function);
+
+ private:
+  struct TaskGroup {
+    std::atomic<int> pending{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr exception;
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+
+  struct Task {
+    std::function<void()> function;
+    TaskGroup* group;
+    CancellationToken* token;
+  };
+
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  // Queue 0 takes tasks from threads outside the pool, the others belong to the workers
+  std::vector<std::unique_ptr<TaskQueue>> queues;
+  std::vector<std::thread> workers;
+
+  std::atomic<int> queuedCount{0};
+  std::mutex sleepMutex;
+  std::condition_variable wakeUp;
+  bool stopping = false;
+
+  void start(int threadCount);
+  void stop();
+  void workerLoop(int queueIndex);
+
+  int currentQueueIndex() const;
+  void push(TaskGroup& group, std::function<void()> function);
+  bool tryRunTask(int queueIndex);
+  void runTask(Task& task);
+  void wait(TaskGroup& group);
+};
+
+// The pool used by all library stages
+TaskPool& getTaskPool();
+
+template <typename Function>
+inline void parallelFor(int begin, int end, int grainSize, const Function& function) {
+  getTaskPool().parallelFor(begin, end, grainSize, function);
+}
+
+template <typename Function>
+void TaskPool::parallelFor(int begin, int end, int grainSize, const Function& function) {
+  if (end <= begin) return;
+  if (grainSize < 1) grainSize = 1;
+  if (end - begin <= grainSize || workers.empty()) {
+    throwIfCancelled();
+    function(begin, end);
+    return;
+  }
+
+  TaskGroup group;
+  std::function<void(int, int)> split = [&](int rangeBegin, int rangeEnd) {
+    while (rangeEnd - rangeBegin > grainSize && !group.failed) {
+      int middle = rangeBegin + (rangeEnd - rangeBegin) / 2;
+      push(group, [&split, middle, rangeEnd]() { split(middle, rangeEnd); });
+      rangeEnd = middle;
+    }
+    if (group.failed) return;
+    throwIfCancelled();
+    function(rangeBegin, rangeEnd);
+  };
+
+  try {
+    split(begin, end);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(group.mutex);
+    if (!group.exception) group.exception = std::current_exception();
+    group.failed = true;
+  }
+
+  wait(group);
+  if (group.exception) std::rethrow_exception(group.exception);
+}
+
+}  // namespace procrock
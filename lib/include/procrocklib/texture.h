@@ -1,26 +1,83 @@
 #pragma once
 
+#include <procrocklib/copy_on_write.h>
+
 #include <Eigen/Core>
-#include <array>
 #include <vector>
 
 namespace procrock {
 struct TextureGroup {
+  // Bit flags to name sets of texture channels
+  enum Channel {
+    Albedo = 1 << 0,
+    Displacement = 1 << 1,
+    Normal = 1 << 2,
+    Roughness = 1 << 3,
+    Metal = 1 << 4,
+    AmbientOcc = 1 << 5,
+    AllChannels = (1 << 6) - 1
+  };
+
   unsigned int width = 512;
   unsigned int height = 512;
   unsigned int albedoChannels = 3;
 
-  struct WorldMapEntry {
-    std::array<Eigen::Vector3f, 9> positions;
-    int face = -1;
+  // Rectangle of texels, textures are processed in tiles of this kind
+  struct Tile {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+  };
+
+  // Maps texels to positions on the mesh surface.
+  // Only the faces are stored per texel, the sample positions are computed on demand from
+  // an affine uv to world transformation of the face.
+  struct WorldMap {
+    static const int maxSampleCount = 9;
+
+    unsigned int width = 0;
+    std::vector<int> faces;        // face the texel lies in, -1 for texels outside of all faces
+    std::vector<int> sourceFaces;  // face the samples are taken from, -1 for unused texels
+
+    struct FaceTransform {
+      Eigen::Vector3d origin{0, 0, 0};  // position of the lower left corner of texel 0
+      Eigen::Vector3d uStep{0, 0, 0};   // movement along the face per texel in u / v direction
+      Eigen::Vector3d vStep{0, 0, 0};
+    };
+    std::vector<FaceTransform> faceTransforms;
+
+    // Where a texel is sampled, in texels from its lower left corner, the results are averaged
+    std::vector<Eigen::Vector2f> sampleOffsets;
+
+    // Above 0 texels are sampled in their center first. Only texels differing from one of their
+    // neighbours by more than the threshold are sampled at all offsets afterwards.
+    float adaptiveThreshold = 0;
+
+    inline int size() const { return faces.size(); }
+    inline bool empty() const { return faces.empty(); }
+
+    // Texels without a source face map to the origin
+    inline Eigen::Vector3f getPosition(int texel, const Eigen::Vector2f& offset) const {
+      const int face = sourceFaces[texel];
+      if (face == -1) return Eigen::Vector3f::Zero();
+
+      const auto& transform = faceTransforms[face];
+      const double x = texel % width + offset.x();
+      const double y = texel / width + offset.y();
+      return (transform.origin + x * transform.uStep + y * transform.vStep).cast<float>();
+    }
   };
-  std::vector<WorldMapEntry> worldMap;
-
-  std::vector<unsigned char> albedoData;
-  std::vector<float> displacementData;
-  std::vector<unsigned char> normalData;
-  std::vector<unsigned char> roughnessData;
-  std::vector<unsigned char> metalData;
-  std::vector<unsigned char> ambientOccData;
+
+  // The world map and the channels are shared between copies of the group until written to,
+  // so stages copying a mesh only pay for what they change.
+  CopyOnWrite<WorldMap> worldMap;
+
+  CopyOnWrite<std::vector<unsigned char>> albedoData;
+  CopyOnWrite<std::vector<float>> displacementData;
+  CopyOnWrite<std::vector<unsigned char>> normalData;
+  CopyOnWrite<std::vector<unsigned char>> roughnessData;
+  CopyOnWrite<std::vector<unsigned char>> metalData;
+  CopyOnWrite<std::vector<unsigned char>> ambientOccData;
 };
-}  // namespace procrock
\ No newline at end of file
+}  // namespace procrock
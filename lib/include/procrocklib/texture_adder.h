@@ -19,6 +19,7 @@ class TextureAdder : public PipelineStage, public Disablable {
   virtual bool isRemovable() const override;
 
   inline bool isFirstRun() const { return firstRun; }
+  inline void setFirstRun(bool firstRun) { this->firstRun = firstRun; }
 
  protected:
   // Maps position to height value
@@ -27,6 +28,7 @@ class TextureAdder : public PipelineStage, public Disablable {
   virtual std::shared_ptr<Mesh> generate(Mesh* before) = 0;
 
   TextureGroup createAddTexture(Mesh& mesh, TextureFunction texFunction);
+  TextureGroup createAddTexture(Mesh& mesh, const NoiseGraph& noiseGraph);
   void addTextures(Mesh& mesh, TextureGroup& addGroup);
 
  protected:
@@ -43,9 +45,6 @@ class TextureAdder : public PipelineStage, public Disablable {
   } preferred;
 
  private:
-  static void fillPart(std::vector<float>& data, int startIndex, int endIndex, const Mesh& mesh,
-                       TextureFunction texFunction, PreferredNormalDirectionStruct preferred);
-
   std::shared_ptr<Mesh> mesh;
   bool firstRun = true;
 };
@@ -19,6 +19,7 @@ class TextureGenerator : public PipelineStage {
   virtual bool isRemovable() const override;
 
   inline bool isFirstRun() const { return firstRun; }
+  inline void setFirstRun(bool firstRun) { this->firstRun = firstRun; }
 
  protected:
   virtual std::shared_ptr<Mesh> generate(Mesh* before) = 0;
@@ -0,0 +1,27 @@
+#pragma once
+#include <procrocklib/texture.h>
+
+#include <string>
+#include <vector>
+
+namespace procrock {
+// Layout of one texture holding several single channels of a texture group in its red, green,
+// blue and alpha channel, so they take one file or one texture bind instead of one each.
+struct ChannelPacking {
+  // TextureGroup::Roughness, Metal, AmbientOcc or Displacement for every channel, 0 leaves the
+  // channel empty. Alpha is only stored if it is used.
+  unsigned int sources[4] = {0, 0, 0, 0};
+  std::string name = "packed";  // goes into the file names
+
+  static ChannelPacking orm();  // ambient occlusion, roughness, metal, the layout gltf reads
+  static ChannelPacking rma();  // roughness, metal, ambient occlusion
+
+  int getChannelCount() const;
+  bool contains(unsigned int channel) const;
+};
+
+// Interleaves the channels of the group. Channels the group has no data for are filled so they
+// shade neutral, with 255 for ambient occlusion and roughness and 0 for the others.
+// Displacement is scaled to bytes.
+std::vector<unsigned char> packChannels(const TextureGroup& group, const ChannelPacking& packing);
+}  // namespace procrock
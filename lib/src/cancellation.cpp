@@ -0,0 +1,19 @@
+#include "cancellation.h"
+
+namespace procrock {
+namespace {
+thread_local CancellationToken* currentToken = nullptr;
+}  // namespace
+
+CancellationScope::CancellationScope(CancellationToken* token) : previous(currentToken) {
+  currentToken = token;
+}
+
+CancellationScope::~CancellationScope() { currentToken = previous; }
+
+CancellationToken* getCurrentCancellationToken() { return currentToken; }
+
+void throwIfCancelled() {
+  if (currentToken != nullptr && currentToken->isCancelled()) throw OperationCancelled();
+}
+}  // namespace procrock
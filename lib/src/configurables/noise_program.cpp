@@ -0,0 +1,548 @@
+#include "configurables/noise_program.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stack>
+
+#include "utils/noise_kernels.h"
+
+namespace procrock {
+namespace {
+std::atomic<bool> noiseCompilationEnabled{true};
+
+inline double linearInterp(double n0, double n1, double a) { return ((1.0 - a) * n0) + (a * n1); }
+inline double sCurve3(double a) { return (a * a * (3.0 - 2.0 * a)); }
+inline double cubicInterp(double n0, double n1, double n2, double n3, double a) {
+  double p = (n3 - n2) - (n0 - n1);
+  double q = (n0 - n1) - p;
+  double r = n2 - n0;
+  double s = n1;
+  return p * a * a * a + q * a * a + r * a + s;
+}
+}  // namespace
+
+void setNoiseCompilationEnabled(bool enabled) { noiseCompilationEnabled = enabled; }
+bool isNoiseCompilationEnabled() { return noiseCompilationEnabled; }
+
+NoiseProgram::NoiseProgram(const NoiseGraph& noiseGraph) {
+  auto& graph = noiseGraph.graph;
+  if (graph.get_root_node_id() == -1) return;
+
+  // Same traversal as evaluateGraph, so the inputs end up in the same source slots
+  std::stack<int> postOrder;
+  dfs_traverse(graph, graph.get_root_node_id(),
+               [&postOrder](const int nodeId) -> void { postOrder.push(nodeId); });
+  std::stack<int> idStack;
+
+  while (!postOrder.empty()) {
+    const int id = postOrder.top();
+    postOrder.pop();
+    NoiseNode* node = graph.node(id);
+
+    if (node->placeholder && graph.num_edges_from_node(id) != 0) continue;
+    std::vector<int> sources;
+    for (int i = 0; i < node->getModule()->GetSourceModuleCount(); i++) {
+      sources.push_back(idStack.top());
+      idStack.pop();
+    }
+    nodeSources[id] = sources;
+    idStack.push(id);
+  }
+
+  resultRegister = compileNode(noiseGraph, idStack.top(), 0);
+
+  nodeSources.clear();
+  compiledNodes.clear();
+}
+
+int NoiseProgram::addInstruction(Instruction instruction, int targetRegisters) {
+  instruction.target = registerCount;
+  registerCount += targetRegisters;
+  instructions.push_back(std::move(instruction));
+  return instructions.back().target;
+}
+
+int NoiseProgram::compileNode(const NoiseGraph& noiseGraph, int nodeId, int coords) {
+  // Nodes used by several others only need to be computed once per set of coordinates
+  auto compiled = compiledNodes.find({nodeId, coords});
+  if (compiled != compiledNodes.end()) return compiled->second;
+
+  NoiseNode* node = noiseGraph.graph.node(nodeId);
+  const auto& sources = nodeSources[nodeId];
+  auto source = [&](int index, int sourceCoords) {
+    return compileNode(noiseGraph, sources[index], sourceCoords);
+  };
+
+  Instruction instruction;
+  instruction.coords = coords;
+  auto combine = [&](OpCode op, int sourceCount) {
+    instruction.op = op;
+    for (int i = 0; i < sourceCount; i++) {
+      instruction.sources[i] = source(i, coords);
+    }
+    return addInstruction(instruction);
+  };
+
+  int result = -1;
+  switch (node->getNodeTypeId()) {
+    case NoiseNodeTypeId_Output:  // translates by 0, so it just passes the value through
+      result = source(0, coords);
+      break;
+    case NoiseNodeTypeId_Add:
+      result = combine(OpCode::Add, 2);
+      break;
+    case NoiseNodeTypeId_Max:
+      result = combine(OpCode::Max, 2);
+      break;
+    case NoiseNodeTypeId_Min:
+      result = combine(OpCode::Min, 2);
+      break;
+    case NoiseNodeTypeId_Multiply:
+      result = combine(OpCode::Multiply, 2);
+      break;
+    case NoiseNodeTypeId_Power:
+      result = combine(OpCode::Power, 2);
+      break;
+    case NoiseNodeTypeId_Blend:
+      result = combine(OpCode::Blend, 3);
+      break;
+    case NoiseNodeTypeId_Select: {
+      auto selectNode = static_cast<SelectNoiseNode*>(node);
+      double lowerBound = selectNode->lowerBound;
+      double upperBound = selectNode->upperBound;
+      double edgeFalloff = selectNode->edgeFalloff;
+      double boundSize = upperBound - lowerBound;
+      instruction.params[0] = lowerBound;
+      instruction.params[1] = upperBound;
+      instruction.params[2] = edgeFalloff > boundSize / 2 ? boundSize / 2 : edgeFalloff;
+      result = combine(OpCode::Select, 3);
+      break;
+    }
+    case NoiseNodeTypeId_Abs:
+      result = combine(OpCode::Abs, 1);
+      break;
+    case NoiseNodeTypeId_Clamp: {
+      auto clampNode = static_cast<ClampNoiseNode*>(node);
+      instruction.params[0] = clampNode->lowerBound;
+      instruction.params[1] = clampNode->upperBound;
+      result = combine(OpCode::Clamp, 1);
+      break;
+    }
+    case NoiseNodeTypeId_Exponent:
+      instruction.params[0] = static_cast<ExponentNoiseNode*>(node)->exponent;
+      result = combine(OpCode::Exponent, 1);
+      break;
+    case NoiseNodeTypeId_Invert:
+      result = combine(OpCode::Invert, 1);
+      break;
+    case NoiseNodeTypeId_ScaleBias: {
+      auto scaleBiasNode = static_cast<ScaleBiasNoiseNode*>(node);
+      instruction.params[0] = scaleBiasNode->scale;
+      instruction.params[1] = scaleBiasNode->bias;
+      result = combine(OpCode::ScaleBias, 1);
+      break;
+    }
+    case NoiseNodeTypeId_Terrace: {
+      auto terraceNode = static_cast<TerraceNoiseNode*>(node);
+      for (auto value : terraceNode->controlPoints.values()) {
+        instruction.controlPoints.emplace_back(value, value);
+      }
+      instruction.intParams[0] = terraceNode->invertTerraces;
+      result = combine(OpCode::Terrace, 1);
+      break;
+    }
+    case NoiseNodeTypeId_Curve: {
+      auto curveNode = static_cast<CurveNoiseNode*>(node);
+      for (auto value : curveNode->configCurve.values()) {
+        instruction.controlPoints.emplace_back(value.first, value.second);
+      }
+      result = combine(OpCode::Curve, 1);
+      break;
+    }
+    case NoiseNodeTypeId_Displace: {
+      instruction.op = OpCode::DisplacePoint;
+      for (int i = 0; i < 3; i++) {
+        instruction.sources[i] = source(i + 1, coords);
+      }
+      instruction.params[0] = 1.0;
+      result = source(0, addInstruction(instruction, 3));
+      break;
+    }
+    case NoiseNodeTypeId_RotatePoint: {
+      auto rotateNode = static_cast<RotatePointNoiseNode*>(node);
+      const double degToRad = M_PI / 180.0;
+      double xCos = std::cos(rotateNode->xAngle * degToRad);
+      double yCos = std::cos(rotateNode->yAngle * degToRad);
+      double zCos = std::cos(rotateNode->zAngle * degToRad);
+      double xSin = std::sin(rotateNode->xAngle * degToRad);
+      double ySin = std::sin(rotateNode->yAngle * degToRad);
+      double zSin = std::sin(rotateNode->zAngle * degToRad);
+
+      // Rows of the rotation matrix, in the same order libnoise sets them up
+      double matrix[9] = {ySin * xSin * zSin + yCos * zCos,  xCos * zSin,
+                          ySin * zCos - yCos * xSin * zSin,  ySin * xSin * zCos - yCos * zSin,
+                          xCos * zCos,                       -yCos * xSin * zCos - ySin * zSin,
+                          -ySin * xCos,                      xSin,
+                          yCos * xCos};
+      instruction.op = OpCode::RotatePoint;
+      std::copy(matrix, matrix + 9, instruction.params);
+      result = source(0, addInstruction(instruction, 3));
+      break;
+    }
+    case NoiseNodeTypeId_ScalePoint: {
+      auto scaleNode = static_cast<ScalePointNoiseNode*>(node);
+      instruction.op = OpCode::ScalePoint;
+      instruction.params[0] = scaleNode->xScale;
+      instruction.params[1] = scaleNode->yScale;
+      instruction.params[2] = scaleNode->zScale;
+      result = source(0, addInstruction(instruction, 3));
+      break;
+    }
+    case NoiseNodeTypeId_TranslatePoint: {
+      auto translateNode = static_cast<TranslatePointNoiseNode*>(node);
+      instruction.op = OpCode::TranslatePoint;
+      instruction.params[0] = translateNode->xTranslation;
+      instruction.params[1] = translateNode->yTranslation;
+      instruction.params[2] = translateNode->zTranslation;
+      result = source(0, addInstruction(instruction, 3));
+      break;
+    }
+    case NoiseNodeTypeId_Turbulence: {
+      // libnoise distorts the coordinates by three perlin noise modules with fixed offsets
+      auto turbulenceNode = static_cast<TurbulenceNoiseNode*>(node);
+      const double offsets[3][3] = {{12414.0 / 65536.0, 65124.0 / 65536.0, 31337.0 / 65536.0},
+                                    {26519.0 / 65536.0, 18128.0 / 65536.0, 60493.0 / 65536.0},
+                                    {53820.0 / 65536.0, 11213.0 / 65536.0, 44845.0 / 65536.0}};
+
+      Instruction displace;
+      displace.op = OpCode::DisplacePoint;
+      displace.coords = coords;
+      displace.params[0] = turbulenceNode->power;
+      for (int i = 0; i < 3; i++) {
+        Instruction translate;
+        translate.op = OpCode::TranslatePoint;
+        translate.coords = coords;
+        std::copy(offsets[i], offsets[i] + 3, translate.params);
+
+        Instruction perlin;
+        perlin.op = OpCode::Perlin;
+        perlin.coords = addInstruction(translate, 3);
+        perlin.params[0] = turbulenceNode->frequency;
+        perlin.params[1] = 2.0;  // libnoise perlin defaults
+        perlin.params[2] = 0.5;
+        perlin.intParams[0] = turbulenceNode->roughness;
+        perlin.intParams[1] = turbulenceNode->seed + i;
+        displace.sources[i] = addInstruction(perlin);
+      }
+      result = source(0, addInstruction(displace, 3));
+      break;
+    }
+    case NoiseNodeTypeId_Const:
+      instruction.op = OpCode::Const;
+      instruction.params[0] = static_cast<ConstNoiseNode*>(node)->value;
+      result = addInstruction(instruction);
+      break;
+    case NoiseNodeTypeId_Perlin: {
+      auto perlinNode = static_cast<PerlinNoiseNode*>(node);
+      instruction.op = OpCode::Perlin;
+      instruction.params[0] = perlinNode->frequency;
+      instruction.params[1] = perlinNode->lacunarity;
+      instruction.params[2] = perlinNode->persistence;
+      instruction.intParams[0] = perlinNode->octaveCount;
+      instruction.intParams[1] = perlinNode->seed;
+      result = addInstruction(instruction);
+      break;
+    }
+    case NoiseNodeTypeId_Billow: {
+      auto billowNode = static_cast<BillowNoiseNode*>(node);
+      instruction.op = OpCode::Billow;
+      instruction.params[0] = billowNode->frequency;
+      instruction.params[1] = billowNode->lacunarity;
+      instruction.params[2] = billowNode->persistence;
+      instruction.intParams[0] = billowNode->octaveCount;
+      instruction.intParams[1] = billowNode->seed;
+      result = addInstruction(instruction);
+      break;
+    }
+    case NoiseNodeTypeId_Ridged: {
+      auto ridgedNode = static_cast<RidgedMultiNoiseNode*>(node);
+      instruction.op = OpCode::Ridged;
+      instruction.params[0] = ridgedNode->frequency;
+      instruction.params[1] = ridgedNode->lacunarity;
+      instruction.intParams[0] = ridgedNode->octaveCount;
+      instruction.intParams[1] = ridgedNode->seed;
+      result = addInstruction(instruction);
+      break;
+    }
+    case NoiseNodeTypeId_Voronoi: {
+      auto voronoiNode = static_cast<VoronoiNoiseNode*>(node);
+      instruction.op = OpCode::Voronoi;
+      instruction.params[0] = voronoiNode->frequency;
+      instruction.params[1] = voronoiNode->displacement;
+      instruction.intParams[0] = voronoiNode->enableDistance;
+      instruction.intParams[1] = voronoiNode->seed;
+      result = addInstruction(instruction);
+      break;
+    }
+    case NoiseNodeTypeId_Spheres:
+      instruction.op = OpCode::Spheres;
+      instruction.params[0] = static_cast<SpheresNoiseNode*>(node)->frequency;
+      result = addInstruction(instruction);
+      break;
+    case NoiseNodeTypeId_Cylinders:
+      instruction.op = OpCode::Cylinders;
+      instruction.params[0] = static_cast<CylindersNoiseNode*>(node)->frequency;
+      result = addInstruction(instruction);
+      break;
+    default:
+      assert(0 && "handle all cases!");
+  }
+
+  compiledNodes[{nodeId, coords}] = result;
+  return result;
+}
+
+void NoiseProgram::evaluate(const double* x, const double* y, const double* z, double* out,
+                            int count) const {
+  if (isEmpty()) {
+    std::fill(out, out + count, 0.0);
+    return;
+  }
+
+  std::vector<double> registers(registerCount * blockSize);
+  for (int start = 0; start < count; start += blockSize) {
+    int blockCount = std::min(blockSize, count - start);
+
+    std::copy(x + start, x + start + blockCount, registers.data());
+    std::copy(y + start, y + start + blockCount, registers.data() + blockSize);
+    std::copy(z + start, z + start + blockCount, registers.data() + 2 * blockSize);
+
+    for (const auto& instruction : instructions) {
+      execute(instruction, registers.data(), blockCount);
+    }
+
+    const double* result = registers.data() + resultRegister * blockSize;
+    std::copy(result, result + blockCount, out + start);
+  }
+}
+
+void NoiseProgram::execute(const Instruction& instruction, double* registers, int count) const {
+  auto reg = [&](int index) { return registers + index * blockSize; };
+
+  double* target = reg(instruction.target);
+  const double* params = instruction.params;
+
+  const double* x = instruction.coords >= 0 ? reg(instruction.coords) : nullptr;
+  const double* y = instruction.coords >= 0 ? reg(instruction.coords + 1) : nullptr;
+  const double* z = instruction.coords >= 0 ? reg(instruction.coords + 2) : nullptr;
+
+  const double* s0 = instruction.sources[0] >= 0 ? reg(instruction.sources[0]) : nullptr;
+  const double* s1 = instruction.sources[1] >= 0 ? reg(instruction.sources[1]) : nullptr;
+  const double* s2 = instruction.sources[2] >= 0 ? reg(instruction.sources[2]) : nullptr;
+
+  switch (instruction.op) {
+    case OpCode::Const:
+      std::fill(target, target + count, params[0]);
+      break;
+    case OpCode::Perlin:
+    case OpCode::Billow:
+    case OpCode::Ridged: {
+      utils::CoherentNoiseParams noiseParams;
+      noiseParams.frequency = params[0];
+      noiseParams.lacunarity = params[1];
+      noiseParams.persistence = params[2];
+      noiseParams.octaveCount = instruction.intParams[0];
+      noiseParams.seed = instruction.intParams[1];
+
+      if (instruction.op == OpCode::Perlin) {
+        utils::perlinNoise(noiseParams, x, y, z, target, count);
+      } else if (instruction.op == OpCode::Billow) {
+        utils::billowNoise(noiseParams, x, y, z, target, count);
+      } else {
+        utils::ridgedMultiNoise(noiseParams, x, y, z, target, count);
+      }
+      break;
+    }
+    case OpCode::Voronoi: {
+      utils::VoronoiParams voronoiParams;
+      voronoiParams.frequency = params[0];
+      voronoiParams.displacement = params[1];
+      voronoiParams.enableDistance = instruction.intParams[0];
+      voronoiParams.seed = instruction.intParams[1];
+      utils::voronoiNoise(voronoiParams, x, y, z, target, count);
+      break;
+    }
+    case OpCode::Spheres:
+    case OpCode::Cylinders:
+      for (int i = 0; i < count; i++) {
+        double px = x[i] * params[0];
+        double py = instruction.op == OpCode::Spheres ? y[i] * params[0] : 0.0;
+        double pz = z[i] * params[0];
+        double distFromCenter = std::sqrt(px * px + py * py + pz * pz);
+        double distFromSmallerSphere = distFromCenter - std::floor(distFromCenter);
+        double distFromLargerSphere = 1.0 - distFromSmallerSphere;
+        double nearestDist = std::min(distFromSmallerSphere, distFromLargerSphere);
+        target[i] = 1.0 - (nearestDist * 4.0);
+      }
+      break;
+    case OpCode::Add:
+      for (int i = 0; i < count; i++) target[i] = s0[i] + s1[i];
+      break;
+    case OpCode::Max:
+      for (int i = 0; i < count; i++) target[i] = s0[i] > s1[i] ? s0[i] : s1[i];
+      break;
+    case OpCode::Min:
+      for (int i = 0; i < count; i++) target[i] = s0[i] < s1[i] ? s0[i] : s1[i];
+      break;
+    case OpCode::Multiply:
+      for (int i = 0; i < count; i++) target[i] = s0[i] * s1[i];
+      break;
+    case OpCode::Power:
+      for (int i = 0; i < count; i++) target[i] = std::pow(s0[i], s1[i]);
+      break;
+    case OpCode::Blend:
+      for (int i = 0; i < count; i++) {
+        target[i] = linearInterp(s0[i], s1[i], (s2[i] + 1.0) / 2.0);
+      }
+      break;
+    case OpCode::Select: {
+      double lowerBound = params[0], upperBound = params[1], edgeFalloff = params[2];
+      for (int i = 0; i < count; i++) {
+        double control = s2[i];
+        if (edgeFalloff > 0.0) {
+          if (control < (lowerBound - edgeFalloff)) {
+            target[i] = s0[i];
+          } else if (control < (lowerBound + edgeFalloff)) {
+            double lowerCurve = (lowerBound - edgeFalloff);
+            double upperCurve = (lowerBound + edgeFalloff);
+            double alpha = sCurve3((control - lowerCurve) / (upperCurve - lowerCurve));
+            target[i] = linearInterp(s0[i], s1[i], alpha);
+          } else if (control < (upperBound - edgeFalloff)) {
+            target[i] = s1[i];
+          } else if (control < (upperBound + edgeFalloff)) {
+            double lowerCurve = (upperBound - edgeFalloff);
+            double upperCurve = (upperBound + edgeFalloff);
+            double alpha = sCurve3((control - lowerCurve) / (upperCurve - lowerCurve));
+            target[i] = linearInterp(s1[i], s0[i], alpha);
+          } else {
+            target[i] = s0[i];
+          }
+        } else {
+          target[i] = (control < lowerBound || control > upperBound) ? s0[i] : s1[i];
+        }
+      }
+      break;
+    }
+    case OpCode::Abs:
+      for (int i = 0; i < count; i++) target[i] = std::fabs(s0[i]);
+      break;
+    case OpCode::Clamp:
+      for (int i = 0; i < count; i++) {
+        if (s0[i] < params[0]) {
+          target[i] = params[0];
+        } else if (s0[i] > params[1]) {
+          target[i] = params[1];
+        } else {
+          target[i] = s0[i];
+        }
+      }
+      break;
+    case OpCode::Exponent:
+      for (int i = 0; i < count; i++) {
+        target[i] = std::pow(std::fabs((s0[i] + 1.0) / 2.0), params[0]) * 2.0 - 1.0;
+      }
+      break;
+    case OpCode::Invert:
+      for (int i = 0; i < count; i++) target[i] = -s0[i];
+      break;
+    case OpCode::ScaleBias:
+      for (int i = 0; i < count; i++) target[i] = s0[i] * params[0] + params[1];
+      break;
+    case OpCode::Terrace: {
+      const auto& points = instruction.controlPoints;
+      const int pointCount = points.size();
+      for (int i = 0; i < count; i++) {
+        int indexPos;
+        for (indexPos = 0; indexPos < pointCount; indexPos++) {
+          if (s0[i] < points[indexPos].first) break;
+        }
+
+        int index0 = std::min(std::max(indexPos - 1, 0), pointCount - 1);
+        int index1 = std::min(std::max(indexPos, 0), pointCount - 1);
+        if (index0 == index1) {
+          target[i] = points[index1].first;
+          continue;
+        }
+
+        double value0 = points[index0].first;
+        double value1 = points[index1].first;
+        double alpha = (s0[i] - value0) / (value1 - value0);
+        if (instruction.intParams[0]) {
+          alpha = 1.0 - alpha;
+          std::swap(value0, value1);
+        }
+        alpha *= alpha;
+        target[i] = linearInterp(value0, value1, alpha);
+      }
+      break;
+    }
+    case OpCode::Curve: {
+      const auto& points = instruction.controlPoints;
+      const int pointCount = points.size();
+      for (int i = 0; i < count; i++) {
+        int indexPos;
+        for (indexPos = 0; indexPos < pointCount; indexPos++) {
+          if (s0[i] < points[indexPos].first) break;
+        }
+
+        int index0 = std::min(std::max(indexPos - 2, 0), pointCount - 1);
+        int index1 = std::min(std::max(indexPos - 1, 0), pointCount - 1);
+        int index2 = std::min(std::max(indexPos, 0), pointCount - 1);
+        int index3 = std::min(std::max(indexPos + 1, 0), pointCount - 1);
+        if (index1 == index2) {
+          target[i] = points[index1].second;
+          continue;
+        }
+
+        double input0 = points[index1].first;
+        double input1 = points[index2].first;
+        double alpha = (s0[i] - input0) / (input1 - input0);
+        target[i] = cubicInterp(points[index0].second, points[index1].second,
+                                points[index2].second, points[index3].second, alpha);
+      }
+      break;
+    }
+    case OpCode::ScalePoint:
+      for (int i = 0; i < count; i++) {
+        target[i] = x[i] * params[0];
+        target[i + blockSize] = y[i] * params[1];
+        target[i + 2 * blockSize] = z[i] * params[2];
+      }
+      break;
+    case OpCode::TranslatePoint:
+      for (int i = 0; i < count; i++) {
+        target[i] = x[i] + params[0];
+        target[i + blockSize] = y[i] + params[1];
+        target[i + 2 * blockSize] = z[i] + params[2];
+      }
+      break;
+    case OpCode::RotatePoint:
+      for (int i = 0; i < count; i++) {
+        target[i] = (params[0] * x[i]) + (params[1] * y[i]) + (params[2] * z[i]);
+        target[i + blockSize] = (params[3] * x[i]) + (params[4] * y[i]) + (params[5] * z[i]);
+        target[i + 2 * blockSize] = (params[6] * x[i]) + (params[7] * y[i]) + (params[8] * z[i]);
+      }
+      break;
+    case OpCode::DisplacePoint:
+      for (int i = 0; i < count; i++) {
+        target[i] = x[i] + s0[i] * params[0];
+        target[i + blockSize] = y[i] + s1[i] * params[0];
+        target[i + 2 * blockSize] = z[i] + s2[i] * params[0];
+      }
+      break;
+    default:
+      assert(0 && "handle all cases!");
+  }
+}
+}  // namespace procrock
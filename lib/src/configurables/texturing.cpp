@@ -5,6 +5,30 @@
 #include "utils/texturing.h"
 
 namespace procrock {
+namespace {
+// Greyscale value of a texel, from the albedo or the displacement channel
+struct GreyscaleSource {
+  GreyscaleSource(const TextureGroup& textureGroup, bool fromAlbedo)
+      : albedoData(*textureGroup.albedoData),
+        displacementData(*textureGroup.displacementData),
+        channels(textureGroup.albedoChannels),
+        fromAlbedo(fromAlbedo) {}
+
+  inline int operator()(int i) const {
+    if (fromAlbedo) {
+      return 0.2989 * (float)albedoData[channels * i] +
+             0.5970 * (float)albedoData[channels * i + 1] +
+             0.1140 * (float)albedoData[channels * i + 2];
+    }
+    return displacementData[i] * 255;
+  }
+
+  const std::vector<unsigned char>& albedoData;
+  const std::vector<float>& displacementData;
+  const int channels;
+  const bool fromAlbedo;
+};
+}  // namespace
 
 // Albedo
 void GradientAlphaAlbedoGenerator::addOwnGroups(Configuration& config, std::string newGroupName,
@@ -12,18 +36,34 @@ void GradientAlphaAlbedoGenerator::addOwnGroups(Configuration& config, std::stri
   coloring.addOwnGroups(config, newGroupName, activeFunc);
 }
 void GradientAlphaAlbedoGenerator::modify(TextureGroup& textureGroup) {
-  textureGroup.albedoData.resize(textureGroup.albedoChannels * textureGroup.width *
-                                 textureGroup.height);
+  utils::modifyTiled(*this, textureGroup);
+}
+
+int GradientAlphaAlbedoGenerator::getSourceChannels() const { return TextureGroup::Displacement; }
+
+bool GradientAlphaAlbedoGenerator::isTileable() const { return true; }
+
+void GradientAlphaAlbedoGenerator::prepareTiles(TextureGroup& textureGroup) {
+  // Every texel is overwritten, so the old buffer is not copied even if it is shared
+  textureGroup.albedoData.reset(std::vector<unsigned char>(
+      textureGroup.albedoChannels * textureGroup.width * textureGroup.height));
+}
+
+void GradientAlphaAlbedoGenerator::modifyTile(TextureGroup& textureGroup,
+                                              const TextureGroup::Tile& tile) {
+  auto& albedoData = textureGroup.albedoData.write();  // not shared after prepareTiles
+  const auto& displacementData = *textureGroup.displacementData;
+  if (displacementData.empty()) return;
 
   const int channels = textureGroup.albedoChannels;
 
-  for (int i = 0; i < textureGroup.displacementData.size(); i++) {
-    auto color = coloring.colorFromValue(textureGroup.displacementData[i]);
+  utils::forEachTexel(textureGroup, tile, [&](int i) {
+    auto color = coloring.colorFromValue(displacementData[i]);
 
     for (int c = 0; c < channels; c++) {
-      textureGroup.albedoData[channels * i + c] = color(c);
+      albedoData[channels * i + c] = color(c);
     }
-  }
+  });
 }
 
 AlbedoAlphaGenerator::AlbedoAlphaGenerator() {
@@ -51,23 +91,52 @@ void AlbedoAlphaGenerator::modify(TextureGroup& textureGroup) {
   methods[choice]->modify(textureGroup);
 }
 
+int AlbedoAlphaGenerator::getSourceChannels() const {
+  return methods[choice]->getSourceChannels();
+}
+
+bool AlbedoAlphaGenerator::isTileable() const { return methods[choice]->isTileable(); }
+
+void AlbedoAlphaGenerator::prepareTiles(TextureGroup& textureGroup) {
+  methods[choice]->prepareTiles(textureGroup);
+}
+
+void AlbedoAlphaGenerator::modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) {
+  methods[choice]->modifyTile(textureGroup, tile);
+}
+
 void GradientAlbedoGenerator::addOwnGroups(Configuration& config, std::string newGroupName,
                                            std::function<bool()> activeFunc) {
   coloring.addOwnGroups(config, newGroupName, activeFunc);
 }
 void GradientAlbedoGenerator::modify(TextureGroup& textureGroup) {
-  textureGroup.albedoData.resize(textureGroup.albedoChannels * textureGroup.width *
-                                 textureGroup.height);
+  utils::modifyTiled(*this, textureGroup);
+}
+
+int GradientAlbedoGenerator::getSourceChannels() const { return TextureGroup::Displacement; }
+
+bool GradientAlbedoGenerator::isTileable() const { return true; }
+
+void GradientAlbedoGenerator::prepareTiles(TextureGroup& textureGroup) {
+  textureGroup.albedoData.reset(std::vector<unsigned char>(
+      textureGroup.albedoChannels * textureGroup.width * textureGroup.height));
+}
+
+void GradientAlbedoGenerator::modifyTile(TextureGroup& textureGroup,
+                                         const TextureGroup::Tile& tile) {
+  auto& albedoData = textureGroup.albedoData.write();  // not shared after prepareTiles
+  const auto& displacementData = *textureGroup.displacementData;
+  if (displacementData.empty()) return;
 
   const int channels = textureGroup.albedoChannels;
 
-  for (int i = 0; i < textureGroup.displacementData.size(); i++) {
-    auto color = coloring.colorFromValue(textureGroup.displacementData[i]);
+  utils::forEachTexel(textureGroup, tile, [&](int i) {
+    auto color = coloring.colorFromValue(displacementData[i]);
 
     for (int c = 0; c < channels; c++) {
-      textureGroup.albedoData[channels * i + c] = color(c);
+      albedoData[channels * i + c] = color(c);
     }
-  }
+  });
 }
 
 void NoiseGradientAlbedoGenerator::addOwnGroups(Configuration& config, std::string newGroupName,
@@ -77,18 +146,11 @@ void NoiseGradientAlbedoGenerator::addOwnGroups(Configuration& config, std::stri
 }
 
 void NoiseGradientAlbedoGenerator::modify(TextureGroup& textureGroup) {
-  textureGroup.albedoData.resize(textureGroup.albedoChannels * textureGroup.width *
-                                 textureGroup.height);
-
-  auto noiseModule = evaluateGraph(noiseGraph);
-  auto floatFunction = [&](Eigen::Vector3f worldPos) {
-    if (noiseModule == nullptr) return 0.0f;
-    float value = (noiseModule->GetValue(worldPos.x(), worldPos.y(), worldPos.z()) + 1) / 2;
-    return std::max(0.0f, std::min(value, 1.0f));
-  };
+  auto& albedoData = textureGroup.albedoData.reset(std::vector<unsigned char>(
+      textureGroup.albedoChannels * textureGroup.width * textureGroup.height));
 
   std::vector<float> tmpFloatTexture;
-  utils::fillFloatTexture(textureGroup, floatFunction, tmpFloatTexture);
+  utils::fillFloatTexture(textureGroup, noiseGraph, tmpFloatTexture);
 
   const int channels = textureGroup.albedoChannels;
 
@@ -96,11 +158,13 @@ void NoiseGradientAlbedoGenerator::modify(TextureGroup& textureGroup) {
     auto color = coloring.colorFromValue(tmpFloatTexture[i]);
 
     for (int c = 0; c < channels; c++) {
-      textureGroup.albedoData[channels * i + c] = color(c);
+      albedoData[channels * i + c] = color(c);
     }
   }
 }
 
+int NoiseGradientAlbedoGenerator::getSourceChannels() const { return 0; }
+
 AlbedoGenerator::AlbedoGenerator() {
   methods.emplace_back(std::make_unique<NoiseGradientAlbedoGenerator>());
   methods.emplace_back(std::make_unique<GradientAlbedoGenerator>());
@@ -127,6 +191,18 @@ void AlbedoGenerator::addOwnGroups(Configuration& config, std::string newGroupNa
 }
 void AlbedoGenerator::modify(TextureGroup& textureGroup) { methods[choice]->modify(textureGroup); }
 
+int AlbedoGenerator::getSourceChannels() const { return methods[choice]->getSourceChannels(); }
+
+bool AlbedoGenerator::isTileable() const { return methods[choice]->isTileable(); }
+
+void AlbedoGenerator::prepareTiles(TextureGroup& textureGroup) {
+  methods[choice]->prepareTiles(textureGroup);
+}
+
+void AlbedoGenerator::modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) {
+  methods[choice]->modifyTile(textureGroup, tile);
+}
+
 // Normals
 void GradientNormalsGenerator::addOwnGroups(Configuration& config, std::string newGroupName,
                                             std::function<bool()> activeFunc) {
@@ -160,18 +236,18 @@ void GradientNormalsGenerator::modify(TextureGroup& textureGroup) {
   assert(textureGroup.albedoChannels == 3 || textureGroup.albedoChannels == 4);
 
   using namespace cimg_library;
-  auto& data = textureGroup.normalData;
+  auto& data = textureGroup.normalData.reset();
   data.clear();
   data.resize(textureGroup.width * textureGroup.height * 3);
 
   CImg<float> image;
   switch (sourceChannel) {
     case 0:
-      image = CImg<float>(textureGroup.displacementData.data(), 1, textureGroup.width,
+      image = CImg<float>(textureGroup.displacementData->data(), 1, textureGroup.width,
                           textureGroup.height);
       break;
     case 1:
-      image = CImg<unsigned char>(textureGroup.albedoData.data(), textureGroup.albedoChannels,
+      image = CImg<unsigned char>(textureGroup.albedoData->data(), textureGroup.albedoChannels,
                                   textureGroup.width, textureGroup.height);
       break;
     default:
@@ -197,6 +273,10 @@ void GradientNormalsGenerator::modify(TextureGroup& textureGroup) {
   }
 }
 
+int GradientNormalsGenerator::getSourceChannels() const {
+  return sourceChannel == 0 ? TextureGroup::Displacement : TextureGroup::Albedo;
+}
+
 NormalsGenerator::NormalsGenerator() {
   methods.emplace_back(std::make_unique<GradientNormalsGenerator>());
 }
@@ -218,6 +298,8 @@ void NormalsGenerator::addOwnGroups(Configuration& config, std::string newGroupN
 }
 void NormalsGenerator::modify(TextureGroup& textureGroup) { methods[choice]->modify(textureGroup); }
 
+int NormalsGenerator::getSourceChannels() const { return methods[choice]->getSourceChannels(); }
+
 // Roughness
 void GreyscaleRoughnessGenerator::addOwnGroups(Configuration& config, std::string newGroupName,
                                                std::function<bool()> activeFunc) {
@@ -239,43 +321,31 @@ void GreyscaleRoughnessGenerator::addOwnGroups(Configuration& config, std::strin
 }
 
 void GreyscaleRoughnessGenerator::modify(TextureGroup& textureGroup) {
-  using namespace cimg_library;
+  utils::modifyTiled(*this, textureGroup);
+}
 
-  auto& data = textureGroup.roughnessData;
+int GreyscaleRoughnessGenerator::getSourceChannels() const {
+  return sourceChannel == 0 ? TextureGroup::Albedo : TextureGroup::Displacement;
+}
 
-  data.clear();
-  data.resize(textureGroup.width * textureGroup.height);
+bool GreyscaleRoughnessGenerator::isTileable() const { return true; }
 
-  CImg<float> image;
-  switch (sourceChannel) {
-    case 0:
-      image = CImg<unsigned char>(textureGroup.albedoData.data(), textureGroup.albedoChannels,
-                                  textureGroup.width, textureGroup.height);
-      break;
-    case 1:
-      image = CImg<float>(textureGroup.displacementData.data(), 1, textureGroup.width,
-                          textureGroup.height);
-      break;
-    default:
-      assert("Handle all cases!" && 0);
-  }
+void GreyscaleRoughnessGenerator::prepareTiles(TextureGroup& textureGroup) {
+  textureGroup.roughnessData.reset(
+      std::vector<unsigned char>(textureGroup.width * textureGroup.height));
+}
 
-  image.permute_axes("YZCX");
+void GreyscaleRoughnessGenerator::modifyTile(TextureGroup& textureGroup,
+                                             const TextureGroup::Tile& tile) {
+  auto& data = textureGroup.roughnessData.write();
+  GreyscaleSource greyscale(textureGroup, sourceChannel == 0);
 
-  for (int i = 0; i < textureGroup.width * textureGroup.height; i++) {
-    int value = 0;
-    int y = i / textureGroup.width;
-    int x = i % textureGroup.width;
-    if (sourceChannel == 0) {
-      value = 0.2989 * (float)image(x, y, 0, 0) + 0.5970 * (float)image(x, y, 0, 1) +
-              0.1140 * (float)image(x, y, 0, 2);
-    } else {
-      value = image(x, y) * 255;
-    }
+  utils::forEachTexel(textureGroup, tile, [&](int i) {
+    int value = greyscale(i);
     value *= scaling;
     value += bias;
     data[i] = std::min(255, std::max(0, value));
-  }
+  });
 }
 
 RoughnessGenerator::RoughnessGenerator() {
@@ -301,6 +371,18 @@ void RoughnessGenerator::modify(TextureGroup& textureGroup) {
   methods[choice]->modify(textureGroup);
 }
 
+int RoughnessGenerator::getSourceChannels() const { return methods[choice]->getSourceChannels(); }
+
+bool RoughnessGenerator::isTileable() const { return methods[choice]->isTileable(); }
+
+void RoughnessGenerator::prepareTiles(TextureGroup& textureGroup) {
+  methods[choice]->prepareTiles(textureGroup);
+}
+
+void RoughnessGenerator::modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) {
+  methods[choice]->modifyTile(textureGroup, tile);
+}
+
 // Metallness
 void GreyscaleMetalnessGenerator::addOwnGroups(Configuration& config, std::string newGroupName,
                                                std::function<bool()> activeFunc) {
@@ -333,39 +415,27 @@ void GreyscaleMetalnessGenerator::addOwnGroups(Configuration& config, std::strin
   config.insertToConfigGroups(newGroupName, greyscaleGroup);
 }
 void GreyscaleMetalnessGenerator::modify(TextureGroup& textureGroup) {
-  using namespace cimg_library;
+  utils::modifyTiled(*this, textureGroup);
+}
 
-  auto& data = textureGroup.metalData;
+int GreyscaleMetalnessGenerator::getSourceChannels() const {
+  return sourceChannel == 0 ? TextureGroup::Albedo : TextureGroup::Displacement;
+}
 
-  data.clear();
-  data.resize(textureGroup.width * textureGroup.height);
+bool GreyscaleMetalnessGenerator::isTileable() const { return true; }
 
-  CImg<float> image;
-  switch (sourceChannel) {
-    case 0:
-      image = CImg<unsigned char>(textureGroup.albedoData.data(), textureGroup.albedoChannels,
-                                  textureGroup.width, textureGroup.height);
-      break;
-    case 1:
-      image = CImg<float>(textureGroup.displacementData.data(), 1, textureGroup.width,
-                          textureGroup.height);
-      break;
-    default:
-      assert("Handle all cases!" && 0);
-  }
-  image.permute_axes("YZCX");
+void GreyscaleMetalnessGenerator::prepareTiles(TextureGroup& textureGroup) {
+  textureGroup.metalData.reset(
+      std::vector<unsigned char>(textureGroup.width * textureGroup.height));
+}
 
-  for (int i = 0; i < textureGroup.width * textureGroup.height; i++) {
-    int value = 0;
-    int y = i / textureGroup.width;
-    int x = i % textureGroup.width;
-    if (sourceChannel == 0) {
-      value = 0.2989 * (float)image(x, y, 0, 0) + 0.5970 * (float)image(x, y, 0, 1) +
-              0.1140 * (float)image(x, y, 0, 2);
-    } else {
-      value = image(x, y) * 255;
-    }
+void GreyscaleMetalnessGenerator::modifyTile(TextureGroup& textureGroup,
+                                             const TextureGroup::Tile& tile) {
+  auto& data = textureGroup.metalData.write();
+  GreyscaleSource greyscale(textureGroup, sourceChannel == 0);
 
+  utils::forEachTexel(textureGroup, tile, [&](int i) {
+    int value = greyscale(i);
     value *= scaling;
     value += bias;
     value = std::min(255, std::max(0, value));
@@ -382,7 +452,7 @@ void GreyscaleMetalnessGenerator::modify(TextureGroup& textureGroup) {
         data[i] = value;
       }
     }
-  }
+  });
 }
 
 MetalnessGenerator::MetalnessGenerator() {
@@ -408,6 +478,18 @@ void MetalnessGenerator::modify(TextureGroup& textureGroup) {
   methods[choice]->modify(textureGroup);
 }
 
+int MetalnessGenerator::getSourceChannels() const { return methods[choice]->getSourceChannels(); }
+
+bool MetalnessGenerator::isTileable() const { return methods[choice]->isTileable(); }
+
+void MetalnessGenerator::prepareTiles(TextureGroup& textureGroup) {
+  methods[choice]->prepareTiles(textureGroup);
+}
+
+void MetalnessGenerator::modifyTile(TextureGroup& textureGroup, const TextureGroup::Tile& tile) {
+  methods[choice]->modifyTile(textureGroup, tile);
+}
+
 // Ambient Occ.
 void GreyscaleAmbientOcclusionGenerator::addOwnGroups(Configuration& config,
                                                       std::string newGroupName,
@@ -428,43 +510,31 @@ void GreyscaleAmbientOcclusionGenerator::addOwnGroups(Configuration& config,
   config.insertToConfigGroups(newGroupName, greyscaleGroup);
 }
 void GreyscaleAmbientOcclusionGenerator::modify(TextureGroup& textureGroup) {
-  using namespace cimg_library;
+  utils::modifyTiled(*this, textureGroup);
+}
 
-  auto& data = textureGroup.ambientOccData;
+int GreyscaleAmbientOcclusionGenerator::getSourceChannels() const {
+  return sourceChannel == 0 ? TextureGroup::Displacement : TextureGroup::Albedo;
+}
 
-  data.clear();
-  data.resize(textureGroup.width * textureGroup.height);
+bool GreyscaleAmbientOcclusionGenerator::isTileable() const { return true; }
 
-  CImg<float> image;
-  switch (sourceChannel) {
-    case 0:
-      image = CImg<float>(textureGroup.displacementData.data(), 1, textureGroup.width,
-                          textureGroup.height);
-      break;
-    case 1:
-      image = CImg<unsigned char>(textureGroup.albedoData.data(), textureGroup.albedoChannels,
-                                  textureGroup.width, textureGroup.height);
-      break;
-    default:
-      assert("Handle all cases!" && 0);
-  }
-  image.permute_axes("YZCX");
+void GreyscaleAmbientOcclusionGenerator::prepareTiles(TextureGroup& textureGroup) {
+  textureGroup.ambientOccData.reset(
+      std::vector<unsigned char>(textureGroup.width * textureGroup.height));
+}
 
-  for (int i = 0; i < textureGroup.width * textureGroup.height; i++) {
-    int value = 0;
-    int y = i / textureGroup.width;
-    int x = i % textureGroup.width;
-    if (sourceChannel == 1) {
-      value = 0.2989 * (float)image(x, y, 0, 0) + 0.5970 * (float)image(x, y, 0, 1) +
-              0.1140 * (float)image(x, y, 0, 2);
-    } else {
-      value = image(x, y) * 255;
-    }
+void GreyscaleAmbientOcclusionGenerator::modifyTile(TextureGroup& textureGroup,
+                                                    const TextureGroup::Tile& tile) {
+  auto& data = textureGroup.ambientOccData.write();
+  GreyscaleSource greyscale(textureGroup, sourceChannel == 1);
 
+  utils::forEachTexel(textureGroup, tile, [&](int i) {
+    int value = greyscale(i);
     value *= scaling;
     value += bias;
     data[i] = std::min(255, std::max(0, value));
-  }
+  });
 }
 
 AmbientOcclusionGenerator::AmbientOcclusionGenerator() {
@@ -490,4 +560,19 @@ void AmbientOcclusionGenerator::modify(TextureGroup& textureGroup) {
   methods[choice]->modify(textureGroup);
 }
 
+int AmbientOcclusionGenerator::getSourceChannels() const {
+  return methods[choice]->getSourceChannels();
+}
+
+bool AmbientOcclusionGenerator::isTileable() const { return methods[choice]->isTileable(); }
+
+void AmbientOcclusionGenerator::prepareTiles(TextureGroup& textureGroup) {
+  methods[choice]->prepareTiles(textureGroup);
+}
+
+void AmbientOcclusionGenerator::modifyTile(TextureGroup& textureGroup,
+                                           const TextureGroup::Tile& tile) {
+  methods[choice]->modifyTile(textureGroup, tile);
+}
+
 }  // namespace procrock
\ No newline at end of file
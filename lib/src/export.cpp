@@ -1,11 +1,143 @@
 #include "export.h"
 
 #include <igl/writeOBJ.h>
-#include <stb_image_write.h>
+
+#include <Eigen/Geometry>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <sstream>
+
+#include "task_pool.h"
+#include "utils/convert_kernels.h"
+#include "utils/dds_writer.h"
+#include "utils/float_image_writer.h"
+#include "utils/png_writer.h"
 
 namespace procrock {
+namespace {
+// Constants of the gltf specification
+const unsigned int glbMagic = 0x46546c67;  // "glTF"
+const unsigned int glbVersion = 2;
+const unsigned int glbChunkJson = 0x4e4f534a;
+const unsigned int glbChunkBin = 0x004e4942;
+const int componentUnsignedShort = 5123;
+const int componentUnsignedInt = 5125;
+const int componentFloat = 5126;
+const int targetArrayBuffer = 34962;
+const int targetElementArrayBuffer = 34963;
+const int filterLinear = 9729;
+const int filterLinearMipmapLinear = 9987;
+
+// Binary chunk of a glb file together with the gltf views and accessors into it
+struct GlbBuffer {
+  std::vector<unsigned char> bytes;
+  nlohmann::json views = nlohmann::json::array();
+  nlohmann::json accessors = nlohmann::json::array();
+
+  // Views start at multiples of 4 bytes, as float accessors require
+  int addView(const void* data, size_t size, int target = 0) {
+    bytes.resize((bytes.size() + 3) & ~size_t(3));
+    nlohmann::json view{{"buffer", 0}, {"byteOffset", bytes.size()}, {"byteLength", size}};
+    if (target != 0) view["target"] = target;
+    const auto* begin = static_cast<const unsigned char*>(data);
+    bytes.insert(bytes.end(), begin, begin + size);
+    views.push_back(view);
+    return views.size() - 1;
+  }
+
+  template <typename T>
+  int addAccessor(const std::vector<T>& data, int components, int componentType,
+                  const char* type, int target) {
+    nlohmann::json accessor{{"bufferView", addView(data.data(), data.size() * sizeof(T), target)},
+                            {"componentType", componentType},
+                            {"count", data.size() / components},
+                            {"type", type}};
+    accessors.push_back(accessor);
+    return accessors.size() - 1;
+  }
+};
+
+void appendUint32(std::vector<unsigned char>& bytes, unsigned int value) {
+  for (int b = 0; b < 4; b++) bytes.push_back((value >> (8 * b)) & 0xff);
+}
+
+template <typename Index>
+int addIndices(const Mesh& mesh, int componentType, GlbBuffer& buffer) {
+  std::vector<Index> indices(mesh.faces.size());
+  for (int face = 0; face < mesh.faces.rows(); face++) {
+    for (int corner = 0; corner < 3; corner++) {
+      indices[3 * face + corner] = mesh.faces(face, corner);
+    }
+  }
+  return buffer.addAccessor(indices, 1, componentType, "SCALAR", targetElementArrayBuffer);
+}
+
+// Adds the vertex attributes and indices of the mesh, returns its gltf primitive
+nlohmann::json addPrimitive(const Mesh& mesh, GlbBuffer& buffer) {
+  const int vertexCount = mesh.vertices.rows();
+  std::vector<float> positions(3 * vertexCount), normals(3 * vertexCount);
+  std::vector<float> uvs(2 * vertexCount), tangents(4 * vertexCount);
+
+  // The tangent frames of the faces around a vertex are summed up and made orthogonal to its
+  // normal, the sign of the bitangent goes into w
+  const bool hasTangents = (int)mesh.faceFrames.size() == mesh.faces.rows();
+  std::vector<Eigen::Vector3f> tangentSums, bitangentSums;
+  if (hasTangents) {
+    tangentSums.assign(vertexCount, Eigen::Vector3f::Zero());
+    bitangentSums.assign(vertexCount, Eigen::Vector3f::Zero());
+    for (int face = 0; face < mesh.faces.rows(); face++) {
+      for (int corner = 0; corner < 3; corner++) {
+        tangentSums[mesh.faces(face, corner)] += mesh.faceFrames[face].col(0);
+        bitangentSums[mesh.faces(face, corner)] += mesh.faceFrames[face].col(1);
+      }
+    }
+  }
+
+  parallelFor(0, vertexCount, 4096, [&](int begin, int end) {
+    for (int v = begin; v < end; v++) {
+      Eigen::Vector3f normal = mesh.normals.row(v).cast<float>().normalized();
+      for (int c = 0; c < 3; c++) {
+        positions[3 * v + c] = mesh.vertices(v, c);
+        normals[3 * v + c] = normal[c];
+      }
+      // Gltf puts the uv origin in the upper left corner
+      uvs[2 * v] = mesh.uvs(v, 0);
+      uvs[2 * v + 1] = 1.0f - mesh.uvs(v, 1);
+
+      if (!hasTangents) continue;
+      Eigen::Vector3f tangent = tangentSums[v] - normal * normal.dot(tangentSums[v]);
+      tangent = tangent.squaredNorm() > 1e-12f ? tangent.normalized() : normal.unitOrthogonal();
+      for (int c = 0; c < 3; c++) tangents[4 * v + c] = tangent[c];
+      tangents[4 * v + 3] = normal.cross(tangent).dot(bitangentSums[v]) < 0.0f ? -1.0f : 1.0f;
+    }
+  });
+
+  nlohmann::json attributes;
+  attributes["POSITION"] =
+      buffer.addAccessor(positions, 3, componentFloat, "VEC3", targetArrayBuffer);
+  Eigen::Vector3d minPosition = mesh.vertices.colwise().minCoeff();
+  Eigen::Vector3d maxPosition = mesh.vertices.colwise().maxCoeff();
+  buffer.accessors.back()["min"] = {minPosition.x(), minPosition.y(), minPosition.z()};
+  buffer.accessors.back()["max"] = {maxPosition.x(), maxPosition.y(), maxPosition.z()};
+  attributes["NORMAL"] = buffer.addAccessor(normals, 3, componentFloat, "VEC3", targetArrayBuffer);
+  if (hasTangents) {
+    attributes["TANGENT"] =
+        buffer.addAccessor(tangents, 4, componentFloat, "VEC4", targetArrayBuffer);
+  }
+  attributes["TEXCOORD_0"] = buffer.addAccessor(uvs, 2, componentFloat, "VEC2", targetArrayBuffer);
+
+  // Short indices where they are enough
+  const int indices = vertexCount <= 0xffff
+                          ? addIndices<unsigned short>(mesh, componentUnsignedShort, buffer)
+                          : addIndices<unsigned int>(mesh, componentUnsignedInt, buffer);
+  return nlohmann::json{{"attributes", attributes}, {"indices", indices}};
+}
+}  // namespace
+
 void exportMesh(Mesh& mesh, const std::string filepath, bool albedo, bool normals, bool roughness,
-                bool metal, bool displace, bool ambientOcc) {
+                bool metal, bool displace, bool ambientOcc, int compressionLevel,
+                bool compressTextures, bool albedoBC7, const ChannelPacking* packing,
+                DisplacementFormat displacementFormat) {
   igl::writeOBJ(filepath, mesh.vertices, mesh.faces, mesh.normals, mesh.faces, mesh.uvs,
                 mesh.faces);
 
@@ -19,47 +151,212 @@ void exportMesh(Mesh& mesh, const std::string filepath, bool albedo, bool normal
 
   base = base + "-tex-";
 
-  stbi_flip_vertically_on_write(true);
+  struct Image {
+    std::string name;
+    int channels;
+    const unsigned char* data;
+    utils::BlockFormat format;
+    const float* floats = nullptr;  // converted as the file is written
+  };
+  const auto albedoFormat = albedoBC7 ? utils::BlockFormat::BC7 : utils::BlockFormat::BC1;
+  std::vector<Image> images;
 
   if (albedo) {
-    std::string albedoFile = base + "albedo.png";
-    stbi_write_png(albedoFile.c_str(), mesh.textures.width, mesh.textures.height, 3,
-                   mesh.textures.albedoData.data(), 0);
+    images.push_back({"albedo", 3, mesh.textures.albedoData->data(), albedoFormat});
   }
 
   if (normals) {
-    std::string normalFile = base + "normal.png";
-    stbi_write_png(normalFile.c_str(), mesh.textures.width, mesh.textures.height, 3,
-                   mesh.textures.normalData.data(), 0);
+    images.push_back({"normal", 3, mesh.textures.normalData->data(), utils::BlockFormat::BC5});
   }
 
-  if (metal) {
-    std::string metalFile = base + "metal.png";
-    stbi_write_png(metalFile.c_str(), mesh.textures.width, mesh.textures.height, 1,
-                   mesh.textures.metalData.data(), 0);
+  // Channels in the packed texture are not written on their own
+  auto isPacked = [&](TextureGroup::Channel channel) {
+    return packing != nullptr && packing->contains(channel);
+  };
+  std::vector<unsigned char> packedExport;
+  if (packing != nullptr) {
+    packedExport = packChannels(mesh.textures, *packing);
+    images.push_back({packing->name, packing->getChannelCount(), packedExport.data(),
+                      utils::BlockFormat::BC7});
   }
 
-  if (roughness) {
-    std::string roughnessFile = base + "roughness.png";
-    stbi_write_png(roughnessFile.c_str(), mesh.textures.width, mesh.textures.height, 1,
-                   mesh.textures.roughnessData.data(), 0);
+  if (metal && !isPacked(TextureGroup::Metal)) {
+    images.push_back({"metal", 1, mesh.textures.metalData->data(), utils::BlockFormat::BC4});
   }
 
-  if (ambientOcc) {
-    std::string ambientOccFile = base + "ambientOcc.png";
-    stbi_write_png(ambientOccFile.c_str(), mesh.textures.width, mesh.textures.height, 1,
-                   mesh.textures.ambientOccData.data(), 0);
+  if (roughness && !isPacked(TextureGroup::Roughness)) {
+    images.push_back({"roughness", 1, mesh.textures.roughnessData->data(),
+                      utils::BlockFormat::BC4});
   }
 
-  if (displace) {
-    std::vector<unsigned char> displacementExport;
-    displacementExport.resize(mesh.textures.displacementData.size());
-    for (int i = 0; i < mesh.textures.displacementData.size(); i++) {
-      displacementExport[i] = mesh.textures.displacementData[i] * 255;
+  if (ambientOcc && !isPacked(TextureGroup::AmbientOcc)) {
+    images.push_back({"ambientOcc", 1, mesh.textures.ambientOccData->data(),
+                      utils::BlockFormat::BC4});
+  }
+
+  // Only dds needs the displacement as bytes up front, the other formats convert it row by row
+  std::vector<unsigned char> displacementExport;
+  if (displace && !isPacked(TextureGroup::Displacement)) {
+    const float* displacementData = mesh.textures.displacementData->data();
+    const bool asDds = compressTextures && displacementFormat == DisplacementFormat::Bytes;
+    if (asDds) {
+      displacementExport.resize(mesh.textures.displacementData->size());
+      parallelFor(0, displacementExport.size(), 1 << 16, [&](int begin, int end) {
+        utils::floatsToBytes(displacementData + begin, &displacementExport[begin], end - begin);
+      });
     }
-    std::string displacementFile = base + "displacement.png";
-    stbi_write_png(displacementFile.c_str(), mesh.textures.width, mesh.textures.height, 1,
-                   displacementExport.data(), 0);
+    images.push_back({"displacement", 1, displacementExport.data(), utils::BlockFormat::BC4,
+                      asDds ? nullptr : displacementData});
   }
+
+  // Every image is encoded by its own task, which spreads its rows over the pool again
+  parallelFor(0, images.size(), 1, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      const auto& image = images[i];
+      const int width = mesh.textures.width;
+      const int height = mesh.textures.height;
+      if (image.floats != nullptr) {
+        switch (displacementFormat) {
+          case DisplacementFormat::Bytes:
+          case DisplacementFormat::Png16:
+            utils::writeGreyPng(base + image.name + ".png", width, height, image.floats,
+                                displacementFormat == DisplacementFormat::Png16 ? 16 : 8,
+                                compressionLevel, true);
+            break;
+          case DisplacementFormat::Exr:
+            utils::writeExr(base + image.name + ".exr", width, height, image.floats, true);
+            break;
+          case DisplacementFormat::RawFloats:
+            utils::writeRawFloats(base + image.name + ".raw", width, height, image.floats, true);
+            break;
+        }
+      } else if (compressTextures) {
+        utils::writeDds(base + image.name + ".dds", image.format, width, height, image.channels,
+                        image.data, image.format == utils::BlockFormat::BC5, true);
+      } else {
+        utils::writePng(base + image.name + ".png", width, height, image.channels, image.data,
+                        compressionLevel, true);
+      }
+    }
+  });
+}
+
+void exportGlb(const std::vector<Mesh>& lods, const std::string filepath, bool albedo,
+               bool normals, bool roughness, bool metal, bool ambientOcc, int compressionLevel) {
+  GlbBuffer buffer;
+  nlohmann::json meshes = nlohmann::json::array();
+  nlohmann::json materials = nlohmann::json::array();
+  nlohmann::json textures = nlohmann::json::array();
+  nlohmann::json nodes = nlohmann::json::array();
+  nlohmann::json sceneNodes = nlohmann::json::array();
+
+  struct Image {
+    const TextureGroup& textures;
+    int channels;
+    const unsigned char* data;
+  };
+  std::vector<Image> images;
+  auto addTexture = [&](const TextureGroup& group, int channels, const unsigned char* data) {
+    images.push_back({group, channels, data});
+    textures.push_back({{"sampler", 0}, {"source", images.size() - 1}});
+    return nlohmann::json{{"index", textures.size() - 1}};
+  };
+
+  std::vector<std::vector<unsigned char>> packedTextures(lods.size());
+
+  for (int lod = 0; lod < lods.size(); lod++) {
+    const Mesh& mesh = lods[lod];
+    const auto& group = mesh.textures;
+    nlohmann::json material{{"name", "rock_LOD" + std::to_string(lod)}};
+    nlohmann::json pbr{{"metallicFactor", 1.0}, {"roughnessFactor", 1.0}};
+
+    if (albedo) {
+      pbr["baseColorTexture"] = addTexture(group, 3, group.albedoData->data());
+    }
+    if (normals) {
+      material["normalTexture"] = addTexture(group, 3, group.normalData->data());
+    }
+    if (roughness || metal || ambientOcc) {
+      // Channels which are not exported are left out of the group, so they are packed with the
+      // neutral fill instead of the generated data
+      TextureGroup exported = group;
+      if (!ambientOcc) exported.ambientOccData.reset();
+      if (!roughness) exported.roughnessData.reset();
+      if (!metal) exported.metalData.reset();
+      packedTextures[lod] = packChannels(exported, ChannelPacking::orm());
+      auto texture = addTexture(group, 3, packedTextures[lod].data());
+      if (roughness || metal) pbr["metallicRoughnessTexture"] = texture;
+      if (ambientOcc) material["occlusionTexture"] = texture;
+    }
+    material["pbrMetallicRoughness"] = pbr;
+    materials.push_back(material);
+
+    auto primitive = addPrimitive(mesh, buffer);
+    primitive["material"] = lod;
+    meshes.push_back({{"primitives", nlohmann::json::array({primitive})}});
+
+    // Engines pick up the levels of detail by the name suffix, LOD0 being the most detailed
+    std::string name = lods.size() > 1 ? "rock_LOD" + std::to_string(lod) : "rock";
+    nodes.push_back({{"name", name}, {"mesh", lod}});
+    sceneNodes.push_back(lod);
+  }
+
+  // The pngs are encoded in parallel and embedded in the binary chunk afterwards
+  std::vector<std::string> pngs(images.size());
+  parallelFor(0, images.size(), 1, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      std::ostringstream stream(std::ios::binary);
+      utils::writePng(stream, images[i].textures.width, images[i].textures.height,
+                      images[i].channels, images[i].data, compressionLevel, true);
+      pngs[i] = stream.str();
+    }
+  });
+  nlohmann::json gltfImages = nlohmann::json::array();
+  for (const auto& png : pngs) {
+    gltfImages.push_back(
+        {{"bufferView", buffer.addView(png.data(), png.size())}, {"mimeType", "image/png"}});
+  }
+
+  buffer.bytes.resize((buffer.bytes.size() + 3) & ~size_t(3));
+  nlohmann::json gltf{
+      {"asset", {{"version", "2.0"}, {"generator", "proc-rock"}}},
+      {"scene", 0},
+      {"scenes", nlohmann::json::array({{{"nodes", sceneNodes}}})},
+      {"nodes", nodes},
+      {"meshes", meshes},
+      {"materials", materials},
+      {"textures", textures},
+      {"images", gltfImages},
+      {"samplers", nlohmann::json::array(
+                       {{{"magFilter", filterLinear}, {"minFilter", filterLinearMipmapLinear}}})},
+      {"accessors", buffer.accessors},
+      {"bufferViews", buffer.views},
+      {"buffers", nlohmann::json::array({{{"byteLength", buffer.bytes.size()}}})}};
+  if (textures.empty()) {
+    gltf.erase("textures");
+    gltf.erase("images");
+    gltf.erase("samplers");
+  }
+
+  // Chunks are padded to 4 bytes, json with spaces
+  std::string json = gltf.dump();
+  json.resize((json.size() + 3) & ~size_t(3), ' ');
+
+  std::vector<unsigned char> header;
+  appendUint32(header, glbMagic);
+  appendUint32(header, glbVersion);
+  appendUint32(header, 12 + 8 + json.size() + 8 + buffer.bytes.size());
+  appendUint32(header, json.size());
+  appendUint32(header, glbChunkJson);
+
+  std::vector<unsigned char> binHeader;
+  appendUint32(binHeader, buffer.bytes.size());
+  appendUint32(binHeader, glbChunkBin);
+
+  std::ofstream file(filepath, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(header.data()), header.size());
+  file.write(json.data(), json.size());
+  file.write(reinterpret_cast<const char*>(binHeader.data()), binHeader.size());
+  file.write(reinterpret_cast<const char*>(buffer.bytes.data()), buffer.bytes.size());
 }
-}  // namespace procrock
\ No newline at end of file
+}  // namespace procrock
@@ -3,7 +3,7 @@
 namespace procrock {
 std::shared_ptr<Mesh> Generator::run(Mesh* before) {
   if (isChanged() || firstRun) {
-    mesh = generate();
+    mesh = runCached(before, [&]() { return generate(); });
   }
 
   if (firstRun) firstRun = !firstRun;
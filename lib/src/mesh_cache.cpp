@@ -0,0 +1,51 @@
+#include "mesh_cache.h"
+
+#include <algorithm>
+
+namespace procrock {
+MeshCache::MeshCache(int capacity) : capacity(capacity) {}
+
+std::shared_ptr<Mesh> MeshCache::get(std::size_t key, const std::string& identity) {
+  auto it = lookup.find(key);
+  if (it == lookup.end() || it->second->identity != identity) return nullptr;
+
+  // Move the entry to the front, it is the most recently used one now
+  entries.splice(entries.begin(), entries, it->second);
+  return it->second->mesh;
+}
+
+void MeshCache::insert(std::size_t key, const std::string& identity,
+                       std::shared_ptr<Mesh> mesh) {
+  if (capacity <= 0) return;
+
+  auto it = lookup.find(key);
+  if (it != lookup.end()) {
+    it->second->identity = identity;
+    it->second->mesh = mesh;
+    entries.splice(entries.begin(), entries, it->second);
+    return;
+  }
+
+  entries.push_front(CacheEntry{key, identity, mesh});
+  lookup[key] = entries.begin();
+
+  while (entries.size() > capacity) {
+    lookup.erase(entries.back().key);
+    entries.pop_back();
+  }
+}
+
+void MeshCache::setCapacity(int capacity) {
+  this->capacity = std::max(0, capacity);
+
+  while (entries.size() > this->capacity) {
+    lookup.erase(entries.back().key);
+    entries.pop_back();
+  }
+}
+
+void MeshCache::clear() {
+  entries.clear();
+  lookup.clear();
+}
+}  // namespace procrock
@@ -3,9 +3,9 @@
 namespace procrock {
 std::shared_ptr<Mesh> Modifier::run(Mesh* before) {
   if (isDisabled()) {
-    mesh = std::make_shared<Mesh>(*before);
+    mesh = runCached(before, [&]() { return std::make_shared<Mesh>(*before); });
   } else if (isChanged() || firstRun) {
-    mesh = modify(*before);
+    mesh = runCached(before, [&]() { return modify(*before); });
   }
 
   if (firstRun) firstRun = !firstRun;
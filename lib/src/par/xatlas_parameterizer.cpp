@@ -2,6 +2,8 @@
 
 #include <xatlas.h>
 
+#include "cancellation.h"
+
 namespace procrock {
 XAtlasParameterizer::XAtlasParameterizer() {
   Configuration::ConfigurationGroup chartGroup;
@@ -114,8 +116,27 @@ std::shared_ptr<Mesh> XAtlasParameterizer::parameterize(Mesh* mesh) {
   pOpts.bruteForce = packOptions.bruteForce;
   pOpts.padding = packOptions.padding;
 
+  // xatlas runs on its own threads, it gets the token directly and stops once it is cancelled
+  CancellationToken* token = getCurrentCancellationToken();
+  if (token != nullptr) {
+    xatlas::SetProgressCallback(
+        atlas,
+        [](xatlas::ProgressCategory::Enum, int, void* userData) {
+          return !static_cast<CancellationToken*>(userData)->isCancelled();
+        },
+        token);
+  }
+
   xatlas::Generate(atlas, cOpts, pOpts);
 
+  if (token != nullptr && token->isCancelled()) {
+    xatlas::Destroy(atlas);
+    delete[] mappedVertices;
+    delete[] mappedNormals;
+    delete[] mappedFaces;
+    throw OperationCancelled();
+  }
+
   auto& atlasMesh = atlas->meshes[0];
   Eigen::MatrixXd newVertices(atlasMesh.vertexCount, 3);
   Eigen::MatrixXd newNormals(atlasMesh.vertexCount, 3);
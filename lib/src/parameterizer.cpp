@@ -1,13 +1,31 @@
 #include "parameterizer.h"
 
-#include <igl/barycentric_coordinates.h>
 #include <igl/per_face_normals.h>
 
-#include <thread>
+#include <Eigen/Geometry>
 
-#include "utils/vector.h"
+#include <sstream>
+
+#include "task_pool.h"
+#include "utils/hash.h"
+#include "utils/texturing.h"
 
 namespace procrock {
+namespace {
+const std::string textureGroupName = "Texture";
+
+// Limits the span [first, last] of sample columns to the ones where value + x * step >= 0
+void clipSpan(double value, double step, double& first, double& last) {
+  if (step > 0) {
+    first = std::max(first, std::ceil(-value / step));
+  } else if (step < 0) {
+    last = std::min(last, std::floor(-value / step));
+  } else if (value < 0) {
+    last = first - 1;
+  }
+}
+}  // namespace
+
 Parameterizer::Parameterizer() {
   Configuration::ConfigurationGroup group;
   group.entry = {"General Texture Settings",
@@ -21,14 +39,38 @@ Parameterizer::Parameterizer() {
                                         {"2048x2048", "Very High Quality"},
                                         {"4096x4096", "Extreme Quality"}},
                                        &textureSizeChoice});
-  config.insertToConfigGroups("Texture", group);
+  group.singleChoices.emplace_back(Configuration::SingleChoiceEntry{
+      {"Sampling", "Choose how many samples are averaged for every texel of the textures."},
+      {{"Single", "One sample in the center of the texel, fast previews."},
+       {"Rotated Grid", "Four samples on a rotated 2x2 grid."},
+       {"Grid", "Nine samples on a 3x3 grid, best quality."},
+       {"Adaptive", "One sample, nine samples where the neighbouring texels differ."}},
+      &samplingChoice});
+  group.floats.emplace_back(Configuration::BoundedEntry<float>{
+      {"Adaptive Threshold", "Difference between neighbouring texels that needs more samples.",
+       [&]() { return samplingChoice == 3; }},
+      &adaptiveThreshold,
+      0.001f,
+      0.5f});
+  config.insertToConfigGroups(textureGroupName, group);
 }
 
 std::shared_ptr<Mesh> Parameterizer::run(Mesh* before) {
   if (isChanged() || firstRun) {
-    mesh = parameterize(before);
-    setTextureGroupSize(*mesh);
-    fillTextureMapFaceBased(*mesh);
+    mesh = runCached(before, [&]() {
+      // The uv layout does not depend on the texture settings, with only those changed, e.g. the
+      // size between preview passes, just the maps are filled again
+      std::ostringstream layoutIdentity;
+      layoutIdentity << (before == nullptr ? 0 : before->hash) << ' '
+                     << utils::serializeConfigurationWithout(config, textureGroupName);
+      auto layout = runCachedPart(layoutIdentity.str(), [&]() { return parameterize(before); });
+
+      auto result = std::make_shared<Mesh>(*layout);
+      setTextureGroupSize(*result);
+      setSamplingPattern(*result);
+      fillTextureMapFaceBased(*result);
+      return result;
+    });
   }
 
   if (firstRun) firstRun = !firstRun;
@@ -44,57 +86,115 @@ void Parameterizer::setTextureGroupSize(Mesh& mesh) {
   mesh.textures.width = size;
 }
 
+void Parameterizer::setSamplingPattern(Mesh& mesh) {
+  auto& worldMap = mesh.textures.worldMap.write();
+  worldMap.adaptiveThreshold = 0;
+
+  switch (samplingChoice) {
+    case 0:
+      worldMap.sampleOffsets = {{0.5f, 0.5f}};
+      break;
+    case 1:
+      worldMap.sampleOffsets = {{0.375f, 0.125f}, {0.875f, 0.375f}, {0.625f, 0.875f},
+                                {0.125f, 0.625f}};
+      break;
+    default:
+      worldMap.sampleOffsets.clear();
+      for (int subY = 0; subY < 3; subY++) {
+        for (int subX = 0; subX < 3; subX++) {
+          worldMap.sampleOffsets.emplace_back(0.5f * subX, 0.5f * subY);
+        }
+      }
+      if (samplingChoice == 3) worldMap.adaptiveThreshold = adaptiveThreshold;
+  }
+}
+
 void Parameterizer::fillTextureMapFaceBased(Mesh& mesh) {
   igl::per_face_normals(mesh.vertices, mesh.faces, mesh.faceNormals);
 
-  std::vector<TextureMapPatch> patches;
-  patches.resize(mesh.faces.rows());
-  const auto threadCount = std::thread::hardware_concurrency();
-  int batchCount = patches.size() / threadCount;
-  auto batches = utils::splitVector(patches, std::max(batchCount, 100));
-
-  std::vector<std::thread> threads;
-  int sizeAcc = 0;
-  for (int i = 0; i < batches.size(); i++) {
-    if (i != 0) {
-      sizeAcc += batches[i - 1].size();
+  const int faceCount = mesh.faces.rows();
+  auto& tex = mesh.textures;
+  auto& worldMap = tex.worldMap.write();
+  worldMap.width = tex.width;
+  worldMap.faces.assign(tex.height * tex.width, -1);
+  worldMap.sourceFaces.assign(tex.height * tex.width, -1);
+  worldMap.faceTransforms.resize(faceCount);
+  mesh.faceTangents.resize(faceCount, 3);
+  mesh.faceFrames.resize(faceCount);
+
+  // Faces are listed by the tiles their bounds overlap, in ascending order
+  const int tilesX = (tex.width + utils::textureTileSize - 1) / utils::textureTileSize;
+  const int tilesY = (tex.height + utils::textureTileSize - 1) / utils::textureTileSize;
+  std::vector<TextureGroup::Tile> tileRanges(faceCount);  // range of tiles per face
+
+  parallelFor(0, faceCount, 64, [&](int begin, int end) {
+    for (int face = begin; face < end; face++) {
+      FaceRaster raster = setupFaceRaster(face, mesh);
+      worldMap.faceTransforms[face] = raster.transform;
+      setFaceFrame(mesh, face);
+
+      const auto& bounds = raster.bounds;
+      auto& range = tileRanges[face];
+      range.x = bounds.x / utils::textureTileSize;
+      range.y = bounds.y / utils::textureTileSize;
+      range.width = std::min(tilesX, (bounds.x + bounds.width + utils::textureTileSize - 1) /
+                                         utils::textureTileSize) -
+                    range.x;
+      range.height = std::min(tilesY, (bounds.y + bounds.height + utils::textureTileSize - 1) /
+                                          utils::textureTileSize) -
+                     range.y;
     }
-    int startIndex = sizeAcc;
-    threads.emplace_back(std::thread(&Parameterizer::fillTextureMapPatches, startIndex,
-                                     startIndex + batches[i].size(), std::ref(batches[i]),
-                                     std::cref(mesh)));
-  }
+  });
 
-  patches.clear();
-  for (int i = 0; i < batches.size(); i++) {
-    threads[i].join();
-    patches.insert(patches.end(), batches[i].begin(), batches[i].end());
+  std::vector<int> tileFaceStarts(tilesX * tilesY + 1, 0);
+  for (const auto& range : tileRanges) {
+    for (int y = range.y; y < range.y + range.height; y++) {
+      for (int x = range.x; x < range.x + range.width; x++) {
+        tileFaceStarts[y * tilesX + x + 1]++;
+      }
+    }
+  }
+  for (int t = 0; t < tilesX * tilesY; t++) {
+    tileFaceStarts[t + 1] += tileFaceStarts[t];
   }
 
-  applyTextureMapPatches(mesh, patches);
-}
-void Parameterizer::fillTextureMapPatches(int startIndex, int endIndex,
-                                          std::vector<TextureMapPatch>& result, const Mesh& mesh) {
-  result.resize(endIndex - startIndex);
-  for (int i = startIndex; i < endIndex; i++) {
-    TextureMapPatch patch{i};
-    fillTextureMapPatch(patch, mesh);
-    result[i - startIndex] = std::move(patch);
+  std::vector<int> tileFaces(tileFaceStarts.back());
+  std::vector<int> tileFaceCounts(tilesX * tilesY, 0);
+  for (int face = 0; face < faceCount; face++) {
+    const auto& range = tileRanges[face];
+    for (int y = range.y; y < range.y + range.height; y++) {
+      for (int x = range.x; x < range.x + range.width; x++) {
+        const int t = y * tilesX + x;
+        tileFaces[tileFaceStarts[t] + tileFaceCounts[t]++] = face;
+      }
+    }
   }
+
+  // Every tile is filled by one task, which rasterizes its faces one after another. A texel
+  // belongs to the first face it lies inside of, texels outside of all faces take their samples
+  // from the last face whose bounds cover them.
+  utils::forEachTile(tex, [&](const TextureGroup::Tile& tile) {
+    const int t = (tile.y / utils::textureTileSize) * tilesX + tile.x / utils::textureTileSize;
+    for (int i = tileFaceStarts[t]; i < tileFaceStarts[t + 1]; i++) {
+      const int face = tileFaces[i];
+      rasterizeFace(face, setupFaceRaster(face, mesh), tile, worldMap);
+    }
+  });
 }
 
-void Parameterizer::fillTextureMapPatch(TextureMapPatch& patch, const Mesh& mesh) {
-  auto face = mesh.faces.row(patch.face);
+Parameterizer::FaceRaster Parameterizer::setupFaceRaster(int face, const Mesh& mesh) {
+  FaceRaster raster;
+  auto faceRow = mesh.faces.row(face);
 
   // Uvs of the current face
-  Eigen::Vector2f uvs[3] = {mesh.uvs.row((face(0))).cast<float>(),
-                            mesh.uvs.row((face(1))).cast<float>(),
-                            mesh.uvs.row((face(2))).cast<float>()};
+  Eigen::Vector2f uvs[3] = {mesh.uvs.row((faceRow(0))).cast<float>(),
+                            mesh.uvs.row((faceRow(1))).cast<float>(),
+                            mesh.uvs.row((faceRow(2))).cast<float>()};
 
   // Positions of the current face
-  Eigen::Vector3f pos[3] = {mesh.vertices.row((face(0))).cast<float>(),
-                            mesh.vertices.row((face(1))).cast<float>(),
-                            mesh.vertices.row((face(2))).cast<float>()};
+  Eigen::Vector3f pos[3] = {mesh.vertices.row((faceRow(0))).cast<float>(),
+                            mesh.vertices.row((faceRow(1))).cast<float>(),
+                            mesh.vertices.row((faceRow(2))).cast<float>()};
 
   // Find boundary box of uv triangle
   double minU = std::max(0.0, std::min({uvs[0](0), uvs[1](0), uvs[2](0)}) - 0.01);
@@ -104,87 +204,51 @@ void Parameterizer::fillTextureMapPatch(TextureMapPatch& patch, const Mesh& mesh
 
   // This value represents one pixel in uv space
   double pixelStep = 1.0 / mesh.textures.width;
-  double pixelStepHalf = pixelStep / 2;
-
-  patch.width = std::ceil((maxU - minU) / pixelStep);
-  patch.height = std::ceil((maxV - minV) / pixelStep);
-  patch.x = minU / pixelStep;
-  patch.y = minV / pixelStep;
-
-  int matrixCols = patch.width * patch.height * 9;
-  Eigen::MatrixXf queries(matrixCols, 2);
-
-  Eigen::MatrixXf corner1(matrixCols, 2);
-  Eigen::MatrixXf corner2(matrixCols, 2);
-  Eigen::MatrixXf corner3(matrixCols, 2);
-
-  // Create queries for barycentriq coordinates
-  for (int x = 0; x < patch.width; x++) {
-    for (int y = 0; y < patch.height; y++) {
-      for (int subX = 0; subX < 3; subX++) {
-        for (int subY = 0; subY < 3; subY++) {
-          double u = minU + (x * pixelStep) + subX * pixelStepHalf;
-          double v = minV + (y * pixelStep) + subY * pixelStepHalf;
-
-          int index = 9 * (x + patch.width * y) + subX + 3 * subY;
-          queries.row(index) << u, v;
-          corner1.row(index) = uvs[0].transpose();
-          corner2.row(index) = uvs[1].transpose();
-          corner3.row(index) = uvs[2].transpose();
-        }
-      }
-    }
-  }
-
-  // Redefine as double for osx / linux builds...
-  Eigen::MatrixXd baryCoordsRes;
-  Eigen::MatrixXd queriesD = queries.cast<double>();
-  Eigen::MatrixXd corner1D = corner1.cast<double>();
-  Eigen::MatrixXd corner2D = corner2.cast<double>();
-  Eigen::MatrixXd corner3D = corner3.cast<double>();
-  igl::barycentric_coordinates(queriesD, corner1D, corner2D, corner3D, baryCoordsRes);
-
-  Eigen::MatrixXf baryCoords = baryCoordsRes.cast<float>();
 
-  // Iterate through the texture part and fill the pixels
-  if (patch.worldMap.size() < patch.height * patch.width) {
-    patch.worldMap.resize(patch.height * patch.width);
+  auto& bounds = raster.bounds;
+  bounds.width = std::ceil((maxU - minU) / pixelStep);
+  bounds.height = std::ceil((maxV - minV) / pixelStep);
+  bounds.x = minU / pixelStep;
+  bounds.y = minV / pixelStep;
+  raster.minU = minU;
+  raster.minV = minV;
+  raster.uvOrigin = uvs[0].cast<double>();
+
+  // Barycentric coordinates and world positions are affine in uv space
+  Eigen::Matrix2d uvEdges;
+  uvEdges.col(0) = (uvs[1] - uvs[0]).cast<double>();
+  uvEdges.col(1) = (uvs[2] - uvs[0]).cast<double>();
+  Eigen::Matrix<double, 3, 2> posEdges;
+  posEdges.col(0) = (pos[1] - pos[0]).cast<double>();
+  posEdges.col(1) = (pos[2] - pos[0]).cast<double>();
+
+  // Samples are taken at the face's own offset to the texel grid, relative to uv (0, 0)
+  Eigen::Vector2d boundsOffset(minU - bounds.x * pixelStep, minV - bounds.y * pixelStep);
+
+  raster.degenerate = uvEdges.determinant() == 0;
+  if (raster.degenerate) {
+    // Degenerate uv triangle, nothing lies inside and everything maps to the center
+    raster.transform.origin = ((pos[0] + pos[1] + pos[2]) / 3.0f).cast<double>();
+  } else {
+    raster.uvToBarycentric = uvEdges.inverse();
+    Eigen::Matrix<double, 3, 2> uvToWorld = posEdges * raster.uvToBarycentric;
+    raster.transform.origin =
+        pos[0].cast<double>() + uvToWorld * (boundsOffset - uvs[0].cast<double>());
+    raster.transform.uStep = uvToWorld.col(0) * pixelStep;
+    raster.transform.vStep = uvToWorld.col(1) * pixelStep;
   }
+  return raster;
+}
 
-  std::array<Eigen::Vector3f, 9> positionsCache;
-
-  for (int x = 0; x < patch.width; x++) {
-    for (int y = 0; y < patch.height; y++) {
-      int index = (x + patch.width * y);
-
-      bool allOutsideTriangle = true;
-
-      for (int n = 0; n < 9; n++) {
-        auto lamda = baryCoords.row(9 * (x + patch.width * y) + n);
-        if (lamda(0) >= -0.005 && lamda(1) >= -0.005 && lamda(2) >= -0.005) {
-          allOutsideTriangle = false;
-        }
-
-        // Calculate coordinates in mesh / world space
-        Eigen::Vector3f worldPos;
-        worldPos(0) = lamda(0) * pos[0](0) + lamda(1) * pos[1](0) + lamda(2) * pos[2](0);
-        worldPos(1) = lamda(0) * pos[0](1) + lamda(1) * pos[1](1) + lamda(2) * pos[2](1);
-        worldPos(2) = lamda(0) * pos[0](2) + lamda(1) * pos[1](2) + lamda(2) * pos[2](2);
-
-        positionsCache[n] = worldPos;
-      }
+void Parameterizer::setFaceFrame(Mesh& mesh, int face) {
+  auto faceRow = mesh.faces.row(face);
+  Eigen::Vector2f uvs[3] = {mesh.uvs.row((faceRow(0))).cast<float>(),
+                            mesh.uvs.row((faceRow(1))).cast<float>(),
+                            mesh.uvs.row((faceRow(2))).cast<float>()};
+  Eigen::Vector3f pos[3] = {mesh.vertices.row((faceRow(0))).cast<float>(),
+                            mesh.vertices.row((faceRow(1))).cast<float>(),
+                            mesh.vertices.row((faceRow(2))).cast<float>()};
 
-      // patch.worldMap[index].positions.fill(Eigen::Vector3f(0));
-      int posIndex = 0;
-      for (const auto& pos : positionsCache) {
-        patch.worldMap[index].positions[posIndex] = pos;
-        posIndex++;
-      }
-      if (!allOutsideTriangle) {
-        patch.worldMap[index].face = patch.face;
-      }
-    }
-  }
   // Calculate Tangents
   Eigen::Vector3f deltaPos1 = pos[1] - pos[0];
   Eigen::Vector3f deltaPos2 = pos[2] - pos[0];
@@ -192,32 +256,75 @@ void Parameterizer::fillTextureMapPatch(TextureMapPatch& patch, const Mesh& mesh
   Eigen::Vector2f deltaUV1 = uvs[1] - uvs[0];
   Eigen::Vector2f deltaUV2 = uvs[2] - uvs[0];
   float r = 1.0f / (deltaUV1.x() * deltaUV2.y() - deltaUV1.y() * deltaUV2.x());
-  patch.faceTangent.x() = r * (deltaUV2.y() * deltaPos1.x() - deltaUV1.y() * deltaPos2.x());
-  patch.faceTangent.y() = r * (deltaUV2.y() * deltaPos1.y() - deltaUV1.y() * deltaPos2.y());
-  patch.faceTangent.z() = r * (deltaUV2.y() * deltaPos1.z() - deltaUV1.y() * deltaPos2.z());
+  Eigen::Vector3f faceTangent;
+  faceTangent.x() = r * (deltaUV2.y() * deltaPos1.x() - deltaUV1.y() * deltaPos2.x());
+  faceTangent.y() = r * (deltaUV2.y() * deltaPos1.y() - deltaUV1.y() * deltaPos2.y());
+  faceTangent.z() = r * (deltaUV2.y() * deltaPos1.z() - deltaUV1.y() * deltaPos2.z());
+  mesh.faceTangents.row(face) = faceTangent.cast<double>();
+
+  Eigen::Vector3f T = faceTangent.normalized();
+  Eigen::Vector3f N = mesh.faceNormals.row(face).cast<float>().normalized();
+  Eigen::Vector3f B = N.cross(T);
+
+  // Normalized a second time, the frames match the former per texel computation exactly
+  auto& frame = mesh.faceFrames[face];
+  frame.col(0) = T.normalized();
+  frame.col(1) = B.normalized();
+  frame.col(2) = N.normalized();
 }
-void Parameterizer::applyTextureMapPatches(Mesh& mesh,
-                                           const std::vector<TextureMapPatch>& patches) {
-  mesh.faceTangents.resize(mesh.faces.rows(), 3);
-  auto& tex = mesh.textures;
-  tex.worldMap.clear();
-  tex.worldMap.resize(tex.height * tex.width);
-
-  for (const auto& patch : patches) {
-    for (int x = 0; x < patch.width; x++) {
-      for (int y = 0; y < patch.height; y++) {
-        int patchIndex = (x + patch.width * y);
-        int globalIndex = (patch.x + x) + tex.width * (patch.y + y);
-        auto& worldEntry = tex.worldMap[globalIndex];
-        auto& patchEntry = patch.worldMap[patchIndex];
-
-        if (worldEntry.face == -1) {  // if this entry is not from an in face computation...
-          worldEntry = patchEntry;
+
+void Parameterizer::rasterizeFace(int face, const FaceRaster& raster,
+                                  const TextureGroup::Tile& tile,
+                                  TextureGroup::WorldMap& worldMap) {
+  const auto& bounds = raster.bounds;
+  const int firstX = std::max(bounds.x, tile.x);
+  const int lastX = std::min(bounds.x + bounds.width, tile.x + tile.width) - 1;
+  const int firstY = std::max(bounds.y, tile.y);
+  const int lastY = std::min(bounds.y + bounds.height, tile.y + tile.height) - 1;
+
+  // Texels not claimed by a face they lie inside of take their samples from this one
+  for (int y = firstY; y <= lastY; y++) {
+    for (int x = firstX; x <= lastX; x++) {
+      const int texel = x + worldMap.width * y;
+      if (worldMap.faces[texel] == -1) worldMap.sourceFaces[texel] = face;
+    }
+  }
+  if (raster.degenerate) return;
+
+  // This value represents one pixel in uv space
+  const double pixelStep = 1.0 / worldMap.width;
+  const double pixelStepHalf = pixelStep / 2;
+
+  // The barycentric coordinates are affine along a row of samples, so the samples inside the
+  // face form one span per row and sub row. The spans are clipped against the three edges,
+  // which is the same as testing every sample with the tolerance.
+  const double tolerance = -0.005;
+  const Eigen::Vector2d columnStep = raster.uvToBarycentric.col(0) * pixelStep;
+
+  for (int y = firstY; y <= lastY; y++) {
+    for (int subY = 0; subY < 3; subY++) {
+      for (int subX = 0; subX < 3; subX++) {
+        double u = raster.minU + subX * pixelStepHalf;
+        double v = raster.minV + ((y - bounds.y) * pixelStep) + subY * pixelStepHalf;
+        Eigen::Vector2d lamda = raster.uvToBarycentric * (Eigen::Vector2d(u, v) - raster.uvOrigin);
+
+        // columns relative to the bounds
+        double first = firstX - bounds.x, last = lastX - bounds.x;
+        clipSpan(lamda(0) - tolerance, columnStep(0), first, last);
+        clipSpan(lamda(1) - tolerance, columnStep(1), first, last);
+        clipSpan(1.0 - lamda(0) - lamda(1) - tolerance, -columnStep(0) - columnStep(1), first,
+                 last);
+        if (first > last) continue;
+
+        for (int x = bounds.x + first; x <= bounds.x + last; x++) {
+          const int texel = x + worldMap.width * y;
+          if (worldMap.faces[texel] == -1) {
+            worldMap.faces[texel] = face;
+            worldMap.sourceFaces[texel] = face;
+          }
         }
       }
     }
-
-    mesh.faceTangents.row(patch.face) = patch.faceTangent.cast<double>();
   }
 }
 }  // namespace procrock
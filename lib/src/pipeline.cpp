@@ -2,15 +2,42 @@
 
 #include <algorithm>
 #include <fstream>
+#include <sstream>
 
+#include "cancellation.h"
 #include "configurable.h"
 #include "export.h"
 #include "mod/displace_along_normals_modifier.h"
 #include "mod/subdivision_modifier.h"
 #include "pipeline_stage_factory.h"
 #include "serialization.h"
+#include "utils/texture_padding.h"
 
 namespace procrock {
+namespace {
+// Replaces the stage if the json describes another type of stage, otherwise only fills in the
+// configuration and disabled state where they differ and marks the stage as changed
+template <typename Stage, typename Create>
+void updateStage(std::unique_ptr<Stage>& stage, const nlohmann::json& json, Create create) {
+  const int id = json.at("_id").get<int>();
+  const auto& configJson = json.at("config");
+  if (stage == nullptr || stage->getInfo().id != id) {
+    stage = create(id);  // runs anyway, it is the first run of the new stage
+  } else if (nlohmann::json(stage->getConfiguration()) != configJson) {
+    stage->setChanged(true);
+  }
+  fillConfigFromJson(configJson, stage->getConfiguration());
+
+  auto disablable = dynamic_cast<Disablable*>(stage.get());
+  if (disablable != nullptr && json.find("disabled") != json.end()) {  // backwards compatible...
+    bool disabled = json.at("disabled").get<bool>();
+    if (disabled != disablable->isDisabled()) {
+      disablable->setDisabled(disabled);
+      stage->setChanged(true);
+    }
+  }
+}
+}  // namespace
 
 void Pipeline::setGenerator(std::unique_ptr<Generator> generator) {
   this->generator = std::move(generator);
@@ -122,29 +149,46 @@ void Pipeline::addTextureAdder(std::unique_ptr<TextureAdder> textureAdder) {
 TextureAdder& Pipeline::getTextureAdder(int index) { return *this->textureAdders[index]; }
 
 const std::shared_ptr<Mesh> Pipeline::getCurrentMesh() {
+  lastProfile = PipelineProfile();
+  profileStart = std::chrono::steady_clock::now();
+  double cpuStart = profiling::getCpuTimeMs();
+
   if (outputEnabled)
     *outputStream << "Running Generator: " << generator->getInfo().name << std::endl;
   bool changed = generator->isChanged() || generator->isFirstRun();
-  auto mesh = this->generator->run();
+  setStageCaches(*generator);
+  auto mesh = runProfiled(*generator, nullptr, changed);
   generator->setChanged(false);
   if (outputEnabled) *outputStream << "Generator Finished" << std::endl << std::endl;
 
-  for (auto& mod : modifiers) {
+  for (int i = 0; i < modifiers.size(); i++) {
+    auto& mod = modifiers[i];
     if (outputEnabled) *outputStream << "Running Modifier: " << mod->getInfo().name << std::endl;
     mod->setChanged(mod->isChanged() || mod->isFirstRun() || changed);
     changed = mod->isChanged();
-    mesh = mod->run(mesh.get());
+    setStageCaches(*mod, i);
+    mesh = runProfiled(*mod, mesh.get(), changed);
     mod->setChanged(false);
     if (outputEnabled) *outputStream << "Modifier Finished." << std::endl << std::endl;
   }
 
   if (outputEnabled) *outputStream << "All Modifiers done." << std::endl << std::endl;
 
+  if (previewDecimation != nullptr) {
+    previewDecimation->setChanged(previewDecimation->isChanged() ||
+                                  previewDecimation->isFirstRun() || changed);
+    changed = previewDecimation->isChanged();
+    setStageCaches(*previewDecimation, modifiers.size());
+    mesh = runProfiled(*previewDecimation, mesh.get(), changed);
+    previewDecimation->setChanged(false);
+  }
+
   if (outputEnabled)
     *outputStream << "Running Parameterizer: " << parameterizer->getInfo().name << std::endl;
   parameterizer->setChanged(parameterizer->isChanged() || parameterizer->isFirstRun() || changed);
   changed = parameterizer->isChanged();
-  mesh = parameterizer->run(mesh.get());
+  setStageCaches(*parameterizer);
+  mesh = runProfiled(*parameterizer, mesh.get(), changed);
   parameterizer->setChanged(false);
   if (outputEnabled) *outputStream << "Parameterizer Finished" << std::endl << std::endl;
 
@@ -153,16 +197,19 @@ const std::shared_ptr<Mesh> Pipeline::getCurrentMesh() {
   textureGenerator->setChanged(textureGenerator->isChanged() || textureGenerator->isFirstRun() ||
                                changed);
   changed = textureGenerator->isChanged();
-  mesh = textureGenerator->run(mesh.get());
+  setStageCaches(*textureGenerator);
+  mesh = runProfiled(*textureGenerator, mesh.get(), changed);
   textureGenerator->setChanged(false);
   if (outputEnabled) *outputStream << "Texture Generator Finished" << std::endl << std::endl;
 
-  for (auto& texadd : textureAdders) {
+  for (int i = 0; i < textureAdders.size(); i++) {
+    auto& texadd = textureAdders[i];
     if (outputEnabled)
       *outputStream << "Running Texture Adder: " << texadd->getInfo().name << std::endl;
     texadd->setChanged(texadd->isChanged() || texadd->isFirstRun() || changed);
     changed = texadd->isChanged();
-    mesh = texadd->run(mesh.get());
+    setStageCaches(*texadd, i);
+    mesh = runProfiled(*texadd, mesh.get(), changed);
     texadd->setChanged(false);
     if (outputEnabled) *outputStream << "Texture Adder Finished" << std::endl << std::endl;
   }
@@ -172,10 +219,54 @@ const std::shared_ptr<Mesh> Pipeline::getCurrentMesh() {
                   << "Pipeline Done" << std::endl
                   << "------------------------" << std::endl;
 
+  lastProfile.wallMs = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - profileStart)
+                           .count();
+  lastProfile.processCpuMs = profiling::getCpuTimeMs() - cpuStart;
+
   currentMesh = mesh;
   return mesh;
 }
 
+const PipelineProfile& Pipeline::getLastProfile() const { return lastProfile; }
+
+std::shared_ptr<Mesh> Pipeline::runProfiled(PipelineStage& stage, Mesh* before, bool changed) {
+  throwIfCancelled();
+
+  StageProfile profile;
+  profile.name = stage.getInfo().name;
+  profile.type = stage.getInfo().type;
+  if (before != nullptr) {
+    profile.inputVertices = before->vertices.rows();
+    profile.inputFaces = before->faces.rows();
+  }
+
+  double cpuStart = profiling::getCpuTimeMs();
+  auto start = std::chrono::steady_clock::now();
+
+  auto mesh = stage.run(before);
+
+  auto end = std::chrono::steady_clock::now();
+  profile.processCpuMs = profiling::getCpuTimeMs() - cpuStart;
+  profile.processPeakMemory = profiling::getPeakMemory();
+  profile.startMs = std::chrono::duration<double, std::milli>(start - profileStart).count();
+  profile.wallMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+  if (!changed) {
+    profile.result = StageProfile::Result::Unchanged;
+  } else if (stage.wasCacheHit()) {
+    profile.result = StageProfile::Result::Cached;
+  }
+
+  profile.outputVertices = mesh->vertices.rows();
+  profile.outputFaces = mesh->faces.rows();
+  profile.textureWidth = mesh->textures.width;
+  profile.textureHeight = mesh->textures.height;
+
+  lastProfile.stages.push_back(profile);
+  return mesh;
+}
+
 void Pipeline::clear() {
   this->generator = std::make_unique<CuboidGenerator>();
   this->modifiers.clear();
@@ -201,11 +292,79 @@ bool Pipeline::isChanged() {
   return result;
 }
 
+void Pipeline::markUnchanged() {
+  generator->setChanged(false);
+  generator->setFirstRun(false);
+  for (auto& mod : modifiers) {
+    mod->setChanged(false);
+    mod->setFirstRun(false);
+  }
+  parameterizer->setChanged(false);
+  parameterizer->setFirstRun(false);
+  textureGenerator->setChanged(false);
+  textureGenerator->setFirstRun(false);
+  for (auto& texAdd : textureAdders) {
+    texAdd->setChanged(false);
+    texAdd->setFirstRun(false);
+  }
+}
+
+void Pipeline::setPreviewFaceCount(int faceCount) {
+  if (faceCount <= 0) {
+    // The parameterizer gets the modifier output again, which nothing else marks as changed
+    if (previewDecimation != nullptr && parameterizer != nullptr) parameterizer->setChanged(true);
+    previewDecimation = nullptr;
+    return;
+  }
+
+  if (previewDecimation == nullptr) {
+    previewDecimation = std::make_unique<DecimateModifier>();
+    previewDecimation->mode = 1;
+  }
+  if (previewDecimation->absoluteValue != faceCount) {
+    previewDecimation->absoluteValue = faceCount;
+    previewDecimation->setChanged(true);
+  }
+}
+
+void Pipeline::setCacheCapacity(int capacity) {
+  cacheCapacity = capacity;
+  for (auto& caches : stageCaches) {
+    caches.second.results.setCapacity(capacity);
+    caches.second.parts.setCapacity(capacity * partsPerResult);
+  }
+}
+
+void Pipeline::clearCache() {
+  for (auto& caches : stageCaches) {
+    caches.second.results.clear();
+    caches.second.parts.clear();
+  }
+}
+
+void Pipeline::setStageCaches(PipelineStage& stage, int position) {
+  auto key = std::make_pair(stage.getInfo().type, position);
+  auto it = stageCaches.find(key);
+  if (it == stageCaches.end()) {
+    StageCaches caches{MeshCache(cacheCapacity), MeshCache(cacheCapacity * partsPerResult)};
+    it = stageCaches.emplace(key, caches).first;
+  }
+  stage.setMeshCache(&it->second.results);
+  stage.setPartCache(&it->second.parts);
+}
+
 void Pipeline::enableOutput(bool enable) { this->outputEnabled = enable; }
 
 void Pipeline::setOutputStream(std::ostream* stream) { this->outputStream = stream; }
 
 void Pipeline::saveToFile(const std::string filePath) {
+  std::ofstream file;
+  file.open(filePath);
+  file << saveToString();
+  file.close();
+}
+
+std::string Pipeline::saveToString() {
   nlohmann::json finalJson;
 
   nlohmann::json genJson =
@@ -236,17 +395,21 @@ void Pipeline::saveToFile(const std::string filePath) {
     finalJson.at("textureAdders").push_back(texAddJson);
   }
 
-  std::ofstream file;
-  file.open(filePath);
-  file << finalJson.dump(1);
-  file.close();
+  return finalJson.dump(1);
 }
 
-void Pipeline::loadFromFile(const std::string filePath) {
+bool Pipeline::loadFromFile(const std::string filePath) {
   std::ifstream file;
   file.open(filePath);
+  std::stringstream content;
+  content << file.rdbuf();
+  file.close();
+  return loadFromString(content.str());
+}
+
+bool Pipeline::loadFromString(const std::string& content) {
   try {
-    auto json = nlohmann::json::parse(file);
+    auto json = nlohmann::json::parse(content);
 
     auto& genJson = json.at("generator");
     setGenerator(createGeneratorFromId(genJson.at("_id").get<int>()));
@@ -283,16 +446,67 @@ void Pipeline::loadFromFile(const std::string filePath) {
     }
   } catch (const std::exception& e) {
     if (outputEnabled) *outputStream << "Error reading file. Try another file." << std::endl;
+    return false;
   }
-  file.close();
+  return true;
+}
+
+bool Pipeline::updateFromString(const std::string& content) {
+  try {
+    auto json = nlohmann::json::parse(content);
+
+    updateStage(generator, json.at("generator"), createGeneratorFromId);
+
+    auto& modsJson = json.at("modifiers");
+    modifiers.resize(std::max(modifiers.size(), modsJson.size()));
+    for (int i = 0; i < modsJson.size(); i++) {
+      updateStage(modifiers[i], modsJson[i], createModifierFromId);
+    }
+    const bool modifiersRemoved = modifiers.size() > modsJson.size();
+    modifiers.resize(modsJson.size());
+
+    updateStage(parameterizer, json.at("parameterizer"), createParameterizerFromId);
+    // Without a changed modifier left to pass it on, the parameterizer gets its new input here
+    if (modifiersRemoved) parameterizer->setChanged(true);
+
+    updateStage(textureGenerator, json.at("textureGenerator"), createTextureGeneratorFromId);
+
+    auto& texAddsJson = json.at("textureAdders");
+    textureAdders.resize(std::max(textureAdders.size(), texAddsJson.size()));
+    for (int i = 0; i < texAddsJson.size(); i++) {
+      updateStage(textureAdders[i], texAddsJson[i], createTextureAdderFromId);
+    }
+    textureAdders.resize(texAddsJson.size());
+  } catch (const std::exception& e) {
+    if (outputEnabled) *outputStream << "Error reading file. Try another file." << std::endl;
+    return false;
+  }
+  return true;
 }
 
 void Pipeline::exportCurrent(const std::string filePath, ExportSettings settings) {
   if (outputEnabled) *outputStream << "Exporting rock..." << std::endl;
-  if (!settings.exportLODs) {
-    exportMesh(*currentMesh, filePath, settings.exportAlbedo, settings.exportNormals,
+
+  // Glb files take all levels of detail at once, so they are collected first, most detailed first
+  std::vector<Mesh> lods(settings.exportLODs ? settings.lodCount : 1);
+
+  // The padding only goes into the exported copy, the stage results stay as they are
+  auto exportPadded = [&](const std::string& path, int lod) {
+    Mesh exported = *currentMesh;
+    utils::padTextures(exported.textures, settings.texturePadding);
+    if (settings.exportGlb) {
+      lods[lod] = std::move(exported);
+      return;
+    }
+    exportMesh(exported, path, settings.exportAlbedo, settings.exportNormals,
                settings.exportRoughness, settings.exportMetal, settings.exportDisplacement,
-               settings.exportAmbientOcc);
+               settings.exportAmbientOcc, settings.compressionLevel, settings.compressTextures,
+               settings.albedoBC7, settings.packTextures ? &settings.packing : nullptr,
+               settings.displacementFormat);
+  };
+
+  if (!settings.exportLODs) {
+    exportPadded(filePath, 0);
   } else {
     int originalTextureSizeChoice = parameterizer->textureSizeChoice;
 
@@ -314,9 +528,7 @@ void Pipeline::exportCurrent(const std::string filePath, ExportSettings settings
       const size_t period_idx = filePath.rfind('.');
       std::string changedPath = filePath;
       changedPath.insert(period_idx, "-lod" + std::to_string(i));
-      exportMesh(*currentMesh, changedPath, settings.exportAlbedo, settings.exportNormals,
-                 settings.exportRoughness, settings.exportMetal, settings.exportDisplacement,
-                 settings.exportAmbientOcc);
+      exportPadded(changedPath, settings.lodCount - 1 - i);
       if (outputEnabled) *outputStream << "Exported LOD " << i << "..." << std::endl;
       if (settings.lodTextures) {
         parameterizer->textureSizeChoice = std::max(0, parameterizer->textureSizeChoice - 1);
@@ -327,6 +539,12 @@ void Pipeline::exportCurrent(const std::string filePath, ExportSettings settings
     removePipelineStage(mod);
   }
 
+  if (settings.exportGlb) {
+    exportGlb(lods, filePath, settings.exportAlbedo, settings.exportNormals,
+              settings.exportRoughness, settings.exportMetal, settings.exportAmbientOcc,
+              settings.compressionLevel);
+  }
+
   if (outputEnabled) *outputStream << "Export finished..." << std::endl;
 }
 
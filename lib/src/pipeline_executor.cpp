@@ -0,0 +1,166 @@
+#include "pipeline_executor.h"
+
+namespace procrock {
+const int PipelineExecutor::previewTextureSizeChoices[3] = {0, 2, 3};  // 128, 512, 1024
+
+PipelineExecutor::PipelineExecutor() {
+  pipeline.enableOutput(false);
+  worker = std::thread(&PipelineExecutor::workerLoop, this);
+}
+
+PipelineExecutor::~PipelineExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    if (runningToken != nullptr) runningToken->cancel();
+  }
+  wakeUp.notify_all();
+  worker.join();
+}
+
+void PipelineExecutor::submit(const std::string& snapshot) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pendingSnapshot = snapshot;
+    snapshotPending = true;
+    if (runningToken != nullptr) runningToken->cancel();
+  }
+  wakeUp.notify_all();
+}
+
+void PipelineExecutor::setProgressive(bool progressive) {
+  std::lock_guard<std::mutex> lock(mutex);
+  this->progressive = progressive;
+}
+
+void PipelineExecutor::submitExport(const std::string& filePath,
+                                    Pipeline::ExportSettings settings) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pendingExports.push_back(ExportJob{filePath, settings});
+  }
+  wakeUp.notify_all();
+}
+
+bool PipelineExecutor::takeResult(Result& result) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!resultReady) return false;
+
+  result = std::move(this->result);
+  this->result = Result();
+  resultReady = false;
+  return true;
+}
+
+bool PipelineExecutor::isBusy() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return snapshotPending || running || exporting || !pendingExports.empty();
+}
+
+bool PipelineExecutor::isExporting() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return exporting || !pendingExports.empty();
+}
+
+std::string PipelineExecutor::getLastError() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return lastError;
+}
+
+void PipelineExecutor::workerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wakeUp.wait(lock, [this]() { return stopping || snapshotPending || !pendingExports.empty(); });
+    if (stopping) return;
+
+    // Snapshots go first, exports belong to the latest one
+    if (snapshotPending) {
+      std::string snapshot = std::move(pendingSnapshot);
+      snapshotPending = false;
+      auto token = std::make_shared<CancellationToken>();
+      runningToken = token;
+      running = true;
+      bool progressiveRun = progressive;
+
+      lock.unlock();
+      runSnapshot(snapshot, *token, progressiveRun);
+      lock.lock();
+
+      runningToken = nullptr;
+      running = false;
+      continue;
+    }
+
+    ExportJob job = pendingExports.front();
+    pendingExports.erase(pendingExports.begin());
+    exporting = true;
+
+    lock.unlock();
+    std::string error;
+    if (!snapshotLoaded) {
+      error = "nothing was generated yet";
+    } else {
+      try {
+        pipeline.setPreviewFaceCount(0);  // a failed preview pass may have left it on
+        pipeline.getCurrentMesh();        // returns right away if the latest snapshot is done
+        pipeline.exportCurrent(job.filePath, job.settings);
+      } catch (const std::exception& e) {
+        error = e.what();
+      }
+    }
+    lock.lock();
+
+    if (!error.empty()) lastError = "Export failed: " + error;
+    exporting = false;
+  }
+}
+
+void PipelineExecutor::runSnapshot(const std::string& snapshot, CancellationToken& token,
+                                   bool progressive) {
+  CancellationScope scope(&token);
+  try {
+    snapshotLoaded = pipeline.updateFromString(snapshot);
+    if (!snapshotLoaded) {
+      std::lock_guard<std::mutex> lock(mutex);
+      lastError = "The pipeline snapshot could not be read.";
+      return;
+    }
+
+    int targetChoice = pipeline.getParameterizer().textureSizeChoice;
+    if (progressive) {
+      bool first = true;
+      for (int choice : previewTextureSizeChoices) {
+        if (choice >= targetChoice) break;
+        publishResult(runPass(choice, first), true);
+        first = false;
+      }
+    }
+    publishResult(runPass(targetChoice, false), false);
+  } catch (const OperationCancelled&) {
+    // A newer snapshot is waiting already
+  } catch (const std::exception& e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    lastError = e.what();
+  }
+}
+
+std::shared_ptr<Mesh> PipelineExecutor::runPass(int textureSizeChoice, bool decimate) {
+  auto& parameterizer = pipeline.getParameterizer();
+  if (parameterizer.textureSizeChoice != textureSizeChoice) {
+    parameterizer.textureSizeChoice = textureSizeChoice;
+    parameterizer.setChanged(true);
+  }
+  // The decimation works on the output of the modifiers, which stays unchanged for later passes
+  pipeline.setPreviewFaceCount(decimate ? previewFaceCount : 0);
+  return pipeline.getCurrentMesh();
+}
+
+void PipelineExecutor::publishResult(std::shared_ptr<Mesh> mesh, bool preview) {
+  std::lock_guard<std::mutex> lock(mutex);
+  result.mesh = mesh;
+  result.profile = pipeline.getLastProfile();
+  result.preview = preview;
+  resultReady = true;
+  lastError.clear();
+}
+}  // namespace procrock
@@ -0,0 +1,65 @@
+#include "pipeline_stage.h"
+
+#include <sstream>
+
+#include "utils/hash.h"
+
+namespace procrock {
+std::shared_ptr<Mesh> PipelineStage::runCached(Mesh* before,
+                                               std::function<std::shared_ptr<Mesh>()> compute) {
+  // The input is identified by its hash, which is the key it was cached under itself
+  std::ostringstream identity;
+  identity << (before == nullptr ? 0 : before->hash) << ' ' << static_cast<int>(getInfo().type)
+           << ' ' << getInfo().id;
+  auto disablable = dynamic_cast<Disablable*>(this);
+  if (disablable != nullptr) identity << ' ' << disablable->isDisabled();
+  identity << ' ' << utils::serializeConfiguration(getConfiguration());
+
+  const std::string identityString = identity.str();
+  const std::size_t key = std::hash<std::string>()(identityString);
+
+  cacheHit = false;
+  if (meshCache != nullptr) {
+    auto cached = meshCache->get(key, identityString);
+    cacheHit = cached != nullptr;
+    if (cacheHit) return cached;
+  }
+
+  auto result = compute();
+  result->hash = key;
+  if (meshCache != nullptr) meshCache->insert(key, identityString, result);
+  return result;
+}
+
+std::shared_ptr<Mesh> PipelineStage::runCachedPart(
+    const std::string& identity, std::function<std::shared_ptr<Mesh>()> compute) {
+  auto part = getCachedPart(identity);
+  if (part != nullptr) return part;
+
+  part = compute();
+  cachePart(identity, part);
+  return part;
+}
+
+namespace {
+// Parts of different stages at the same position never share an identity
+std::string getPartIdentity(PipelineStage& stage, const std::string& identity) {
+  std::ostringstream fullIdentity;
+  fullIdentity << static_cast<int>(stage.getInfo().type) << ' ' << stage.getInfo().id << ' '
+               << identity;
+  return fullIdentity.str();
+}
+}  // namespace
+
+std::shared_ptr<Mesh> PipelineStage::getCachedPart(const std::string& identity) {
+  if (partCache == nullptr) return nullptr;
+  const std::string fullIdentity = getPartIdentity(*this, identity);
+  return partCache->get(std::hash<std::string>()(fullIdentity), fullIdentity);
+}
+
+void PipelineStage::cachePart(const std::string& identity, std::shared_ptr<Mesh> part) {
+  if (partCache == nullptr) return;
+  const std::string fullIdentity = getPartIdentity(*this, identity);
+  partCache->insert(std::hash<std::string>()(fullIdentity), fullIdentity, part);
+}
+}  // namespace procrock
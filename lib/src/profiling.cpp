@@ -0,0 +1,134 @@
+#include "profiling.h"
+
+#include <nlohmann/json.hpp>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+// windows.h has to come first
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#endif
+
+namespace procrock {
+namespace {
+nlohmann::json stageToJson(const StageProfile& stage) {
+  return nlohmann::json{{"name", stage.name},
+                        {"type", getStageTypeName(stage.type)},
+                        {"result", getStageResultName(stage.result)},
+                        {"startMs", stage.startMs},
+                        {"wallMs", stage.wallMs},
+                        {"processCpuMs", stage.processCpuMs},
+                        {"processPeakMemory", stage.processPeakMemory},
+                        {"inputVertices", stage.inputVertices},
+                        {"inputFaces", stage.inputFaces},
+                        {"outputVertices", stage.outputVertices},
+                        {"outputFaces", stage.outputFaces},
+                        {"textureWidth", stage.textureWidth},
+                        {"textureHeight", stage.textureHeight}};
+}
+}  // namespace
+
+std::string PipelineProfile::toJson() const {
+  nlohmann::json stagesJson = nlohmann::json::array();
+  for (const auto& stage : stages) {
+    stagesJson.push_back(stageToJson(stage));
+  }
+
+  nlohmann::json result{{"wallMs", wallMs}, {"processCpuMs", processCpuMs}, {"stages", stagesJson}};
+  return result.dump(2);
+}
+
+std::string PipelineProfile::toChromeTrace() const {
+  nlohmann::json events = nlohmann::json::array();
+  for (const auto& stage : stages) {
+    // Complete events, times are given in microseconds
+    nlohmann::json args = stageToJson(stage);
+    args.erase("name");
+    args.erase("startMs");
+    args.erase("wallMs");
+    events.push_back(nlohmann::json{{"name", stage.name},
+                                    {"cat", getStageTypeName(stage.type)},
+                                    {"ph", "X"},
+                                    {"ts", stage.startMs * 1000},
+                                    {"dur", stage.wallMs * 1000},
+                                    {"pid", 0},
+                                    {"tid", 0},
+                                    {"args", args}});
+  }
+
+  nlohmann::json result{{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+  return result.dump();
+}
+
+const char* getStageTypeName(PipelineStageType type) {
+  switch (type) {
+    case PipelineStageType::Generator:
+      return "Generator";
+    case PipelineStageType::Modifier:
+      return "Modifier";
+    case PipelineStageType::Parameterizer:
+      return "Parameterizer";
+    case PipelineStageType::TextureGenerator:
+      return "Texture Generator";
+    case PipelineStageType::TextureAdder:
+      return "Texture Adder";
+    default:
+      return "No Type";
+  }
+}
+
+const char* getStageResultName(StageProfile::Result result) {
+  switch (result) {
+    case StageProfile::Result::Computed:
+      return "Computed";
+    case StageProfile::Result::Cached:
+      return "Cached";
+    default:
+      return "Unchanged";
+  }
+}
+
+namespace profiling {
+double getCpuTimeMs() {
+#ifdef _WIN32
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+    return 0;
+  }
+  auto toMs = [](const FILETIME& time) {
+    ULARGE_INTEGER value;
+    value.LowPart = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    return value.QuadPart / 10000.0;  // 100ns ticks
+  };
+  return toMs(kernelTime) + toMs(userTime);
+#else
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+#endif
+}
+
+long long getPeakMemory() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+  return counters.PeakWorkingSetSize;
+#else
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+  return usage.ru_maxrss;  // bytes on macOS
+#else
+  return usage.ru_maxrss * 1024LL;  // kilobytes everywhere else
+#endif
+#endif
+}
+}  // namespace profiling
+}  // namespace procrock
@@ -0,0 +1,143 @@
+#include "task_pool.h"
+
+#include <algorithm>
+
+namespace procrock {
+namespace {
+// Lets threads find their own queue, threads outside of any pool use the shared queue 0
+thread_local const TaskPool* currentPool = nullptr;
+thread_local int currentQueue = 0;
+}  // namespace
+
+TaskPool::TaskPool(int threadCount) { start(threadCount); }
+
+TaskPool::~TaskPool() { stop(); }
+
+void TaskPool::setThreadCount(int threadCount) {
+  stop();
+  start(threadCount);
+}
+
+void TaskPool::start(int threadCount) {
+  if (threadCount <= 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  stopping = false;
+  queues.clear();
+  for (int i = 0; i < threadCount; i++) {
+    queues.push_back(std::make_unique<TaskQueue>());
+  }
+  for (int i = 1; i < threadCount; i++) {
+    workers.emplace_back(&TaskPool::workerLoop, this, i);
+  }
+}
+
+void TaskPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  wakeUp.notify_all();
+
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+}
+
+void TaskPool::workerLoop(int queueIndex) {
+  currentPool = this;
+  currentQueue = queueIndex;
+
+  while (true) {
+    if (tryRunTask(queueIndex)) continue;
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    wakeUp.wait(lock, [this]() { return stopping || queuedCount > 0; });
+    if (stopping) return;
+  }
+}
+
+int TaskPool::currentQueueIndex() const { return currentPool == this ? currentQueue : 0; }
+
+void TaskPool::push(TaskGroup& group, std::function<void()> function) {
+  group.pending++;
+  {
+    auto& queue = *queues[currentQueueIndex()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(Task{std::move(function), &group, getCurrentCancellationToken()});
+  }
+  queuedCount++;
+
+  {
+    // Taking the lock makes sure a worker that is about to sleep sees the new task
+    std::lock_guard<std::mutex> lock(sleepMutex);
+  }
+  wakeUp.notify_one();
+}
+
+bool TaskPool::tryRunTask(int queueIndex) {
+  Task task;
+  bool found = false;
+
+  {
+    // Newest task of the own queue first, it works on data that is still in the cache
+    auto& queue = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      found = true;
+    }
+  }
+
+  // Otherwise steal the oldest task of another queue, that is the largest range left there
+  for (int i = 1; i < queues.size() && !found; i++) {
+    auto& queue = *queues[(queueIndex + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      found = true;
+    }
+  }
+
+  if (!found) return false;
+  queuedCount--;
+  runTask(task);
+  return true;
+}
+
+void TaskPool::runTask(Task& task) {
+  TaskGroup& group = *task.group;
+  try {
+    CancellationScope scope(task.token);
+    if (!group.failed) task.function();
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(group.mutex);
+    if (!group.exception) group.exception = std::current_exception();
+    group.failed = true;
+  }
+
+  std::lock_guard<std::mutex> lock(group.mutex);
+  if (--group.pending == 0) group.done.notify_all();
+}
+
+void TaskPool::wait(TaskGroup& group) {
+  const int queueIndex = currentQueueIndex();
+  while (group.pending > 0) {
+    if (tryRunTask(queueIndex)) continue;
+
+    // Nothing left to help with, the remaining tasks of the group are running elsewhere
+    std::unique_lock<std::mutex> lock(group.mutex);
+    group.done.wait(lock, [&group]() { return group.pending == 0; });
+  }
+
+  // The last task might still hold the lock while notifying, the group must outlive that
+  std::lock_guard<std::mutex> lock(group.mutex);
+}
+
+TaskPool& getTaskPool() {
+  static TaskPool pool;
+  return pool;
+}
+}  // namespace procrock
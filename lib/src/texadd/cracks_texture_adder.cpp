@@ -35,19 +35,18 @@ std::shared_ptr<Mesh> CracksTextureAdder::generate(Mesh* before) {
   };
 
   auto texGroup = createAddTexture(*result, colorFunction);
-  CImg<float> image(texGroup.displacementData.data(), 1, texGroup.width, texGroup.height);
+  auto& displacementData = texGroup.displacementData.write();
+  CImg<float> image(displacementData.data(), 1, texGroup.width, texGroup.height);
   image.permute_axes("YZCX");
   auto gradients = image.get_gradient("xy", 3);
-  int index = 0;
-  for (auto& pixel : result->textures.worldMap) {
+  for (int index = 0; index < result->textures.worldMap->size(); index++) {
     Eigen::Vector2f value;
     value.x() = std::abs(gradients[0](index));
     value.y() = std::abs(gradients[1](index));
 
     int relValue = ((value.x() + value.y()) / 2.0);
     relValue = std::min(255, (int)(relValue * strength));
-    texGroup.displacementData[index] = relValue / 255.0;
-    index++;
+    displacementData[index] = relValue / 255.0;
   }
 
   GradientAlphaAlbedoGenerator albedoGen;
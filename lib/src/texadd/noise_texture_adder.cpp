@@ -14,14 +14,7 @@ NoiseTextureAdder::NoiseTextureAdder() {
 std::shared_ptr<Mesh> NoiseTextureAdder::generate(Mesh* before) {
   auto result = std::make_shared<Mesh>(*before);
 
-  auto noiseModule = evaluateGraph(noiseGraph);
-  auto colorFunction = [&](Eigen::Vector3f worldPos) {
-    if (noiseModule == nullptr) return 0.0f;
-    float value = (noiseModule->GetValue(worldPos.x(), worldPos.y(), worldPos.z()) + 1) / 2;
-    return std::max(0.0f, std::min(value, 1.0f));
-  };
-
-  auto texGroup = createAddTexture(*result, colorFunction);
+  auto texGroup = createAddTexture(*result, noiseGraph);
   albedoGenerator.modify(texGroup);
   normalsGenerator.modify(texGroup);
   roughnessGenerator.modify(texGroup);
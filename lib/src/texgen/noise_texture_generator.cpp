@@ -1,8 +1,40 @@
 #include "texgen/noise_texture_generator.h"
 
+#include <map>
+#include <sstream>
+
+#include "utils/hash.h"
 #include "utils/texturing.h"
 
 namespace procrock {
+namespace {
+void copyChannel(const TextureGroup& from, TextureGroup& to, int channel) {
+  switch (channel) {
+    case TextureGroup::Albedo:
+      to.albedoData = from.albedoData;
+      break;
+    case TextureGroup::Displacement:
+      to.displacementData = from.displacementData;
+      break;
+    case TextureGroup::Normal:
+      to.normalData = from.normalData;
+      break;
+    case TextureGroup::Roughness:
+      to.roughnessData = from.roughnessData;
+      break;
+    case TextureGroup::Metal:
+      to.metalData = from.metalData;
+      break;
+    case TextureGroup::AmbientOcc:
+      to.ambientOccData = from.ambientOccData;
+      break;
+    default:
+      assert(0 && "handle all cases!");
+      break;
+  }
+}
+}  // namespace
+
 NoiseTextureGenerator::NoiseTextureGenerator() {
   noiseGraph.addOwnGroups(config, "Displacement / Height");
 
@@ -15,22 +47,82 @@ NoiseTextureGenerator::NoiseTextureGenerator() {
 
 std::shared_ptr<Mesh> NoiseTextureGenerator::generate(Mesh* before) {
   auto result = std::make_shared<Mesh>(*before);
+  auto& textures = result->textures;
+
+  // Channels are cached as parts of the stage's results and reused when their own settings and
+  // the channels they are made from did not change. The input mesh hash covers the texture size
+  // and world map of all channels.
+  std::map<int, std::string> channelIdentities;  // per TextureGroup::Channel
+  auto setIdentity = [&](int channel, const std::string& groupName, int sourceChannels) {
+    std::ostringstream identity;
+    identity << before->hash << ' ' << channel << ' '
+             << utils::serializeConfigurationGroups(config, groupName);
+    for (int source = 1; source < TextureGroup::AllChannels; source <<= 1) {
+      if (sourceChannels & source) identity << ' ' << channelIdentities[source];
+    }
+    channelIdentities[channel] = identity.str();
+  };
+  std::vector<int> computedChannels;
+  auto reuseCached = [&](int channel) {
+    auto cached = getCachedPart(channelIdentities[channel]);
+    if (cached == nullptr) {
+      computedChannels.push_back(channel);
+      return false;
+    }
+    copyChannel(cached->textures, textures, channel);
+    return true;
+  };
+
+  setIdentity(TextureGroup::Displacement, "Displacement / Height", 0);
+  if (!reuseCached(TextureGroup::Displacement)) {
+    utils::fillFloatTexture(textures, noiseGraph, textures.displacementData.write());
+  }
 
-  auto noiseModule = evaluateGraph(noiseGraph);
-  auto heightFunction = [&](Eigen::Vector3f worldPos) {
-    if (noiseModule == nullptr) return 0.0f;
-    float value = (noiseModule->GetValue(worldPos.x(), worldPos.y(), worldPos.z()) + 1) / 2;
-    return std::max(0.0f, std::min(value, 1.0f));
+  // In order, every channel is made only from the ones before it
+  struct ChannelStage {
+    int channel;
+    std::string groupName;
+    TextureGroupModifier* generator;
   };
+  std::vector<ChannelStage> stages{
+      {TextureGroup::Albedo, "Albedo", &albedoGenerator},
+      {TextureGroup::Normal, "Normals", &normalsGenerator},
+      {TextureGroup::Roughness, "Roughness", &roughnessGenerator},
+      {TextureGroup::Metal, "Metalness", &metalnessGenerator},
+      {TextureGroup::AmbientOcc, "Ambient Occlusion", &ambientOccGenerator}};
+
+  // Consecutive generators working texel by texel share one pass over the tiles
+  std::vector<TextureGroupModifier*> tiledGenerators;
+  auto runTiledGenerators = [&]() {
+    if (tiledGenerators.empty()) return;
+    for (auto* generator : tiledGenerators) generator->prepareTiles(textures);
+    utils::forEachTile(textures, [&](const TextureGroup::Tile& tile) {
+      for (auto* generator : tiledGenerators) generator->modifyTile(textures, tile);
+    });
+    tiledGenerators.clear();
+  };
+
+  for (const auto& stage : stages) {
+    setIdentity(stage.channel, stage.groupName, stage.generator->getSourceChannels());
 
-  utils::fillFloatTexture(result->textures, heightFunction, result->textures.displacementData);
+    if (reuseCached(stage.channel)) continue;
 
-  albedoGenerator.modify(result->textures);
-  normalsGenerator.modify(result->textures);
-  roughnessGenerator.modify(result->textures);
-  metalnessGenerator.modify(result->textures);
-  ambientOccGenerator.modify(result->textures);
+    if (stage.generator->isTileable()) {
+      tiledGenerators.push_back(stage.generator);
+    } else {
+      runTiledGenerators();
+      stage.generator->modify(textures);
+    }
+  }
+  runTiledGenerators();
 
+  // Every part only holds its own channel, so the part cache keeps no more texture data than as
+  // many results would
+  for (int channel : computedChannels) {
+    auto part = std::make_shared<Mesh>();
+    copyChannel(textures, part->textures, channel);
+    cachePart(channelIdentities[channel], part);
+  }
   return result;
 }
 PipelineStageInfo& NoiseTextureGenerator::getInfo() { return info; }
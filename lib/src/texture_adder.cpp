@@ -4,9 +4,9 @@
 #include <igl/barycentric_coordinates.h>
 
 #include <Eigen/Eigen>
-#include <thread>
 
-#include "utils/vector.h"
+#include "utils/blend_kernels.h"
+#include "utils/texturing.h"
 
 namespace procrock {
 TextureAdder::TextureAdder(bool hideConfigurables) {
@@ -50,9 +50,9 @@ TextureAdder::TextureAdder(bool hideConfigurables) {
 
 std::shared_ptr<Mesh> TextureAdder::run(Mesh* before) {
   if (isDisabled()) {
-    mesh = std::make_shared<Mesh>(*before);
+    mesh = runCached(before, [&]() { return std::make_shared<Mesh>(*before); });
   } else if (isChanged() || firstRun) {
-    mesh = generate(before);
+    mesh = runCached(before, [&]() { return generate(before); });
   }
 
   if (firstRun) firstRun = !firstRun;
@@ -63,141 +63,144 @@ bool TextureAdder::isMoveable() const { return true; }
 bool TextureAdder::isRemovable() const { return true; }
 
 TextureGroup TextureAdder::createAddTexture(Mesh& mesh, TextureFunction texFunction) {
-  const auto& texGroup = mesh.textures;
-
   TextureGroup addGroup;
   addGroup.albedoChannels = 4;
-  addGroup.width = texGroup.width;
-  addGroup.height = texGroup.height;
-
-  auto& addTexture = addGroup.displacementData;
-
-  addTexture.resize(addGroup.width * addGroup.height);
-  std::fill(addTexture.begin(), addTexture.end(), 0);
+  addGroup.width = mesh.textures.width;
+  addGroup.height = mesh.textures.height;
 
-  const auto threadCount = std::thread::hardware_concurrency();
-  int batchCount = addTexture.size() / threadCount;
-
-  std::vector<std::thread> threads;
-  auto data = utils::splitVector(addTexture, batchCount);
+  utils::fillFloatTexture(mesh.textures, texFunction, addGroup.displacementData.write());
+  return addGroup;
+}
 
-  int sizeAcc = 0;
-  for (int i = 0; i < data.size(); i++) {
-    if (i != 0) {
-      sizeAcc += data[i - 1].size();
-    }
-    int startIndex = sizeAcc;
-    threads.emplace_back(std::thread(&TextureAdder::fillPart, std::ref(data[i]), startIndex,
-                                     startIndex + data[i].size(), std::cref(mesh), texFunction,
-                                     preferred));
-  }
+TextureGroup TextureAdder::createAddTexture(Mesh& mesh, const NoiseGraph& noiseGraph) {
+  TextureGroup addGroup;
+  addGroup.albedoChannels = 4;
+  addGroup.width = mesh.textures.width;
+  addGroup.height = mesh.textures.height;
 
-  addTexture.clear();
-  for (int i = 0; i < data.size(); i++) {
-    threads[i].join();
-    addTexture.insert(addTexture.end(), data[i].begin(), data[i].end());
-  }
+  utils::fillFloatTexture(mesh.textures, noiseGraph, addGroup.displacementData.write());
   return addGroup;
 }
 
 void TextureAdder::addTextures(Mesh& mesh, TextureGroup& addGroup) {
-  auto& addTexture = addGroup.albedoData;
+  auto& addTexture = addGroup.albedoData.write();
   auto& texGroup = mesh.textures;
-
-  for (int i = 0; i < addTexture.size() / 4; i++) {
-    if (preferred.enabled) {
-      auto& pixel = mesh.textures.worldMap[i];
-
-      if (pixel.face == -1) continue;  // skip pixels on non faces..
-
-      Eigen::Vector3i textureNormalSample = {texGroup.normalData[(3 * i)],
-                                             texGroup.normalData[(3 * i) + 1],
-                                             texGroup.normalData[(3 * i) + 2]};
-      Eigen::Vector3f textureNormal = (textureNormalSample.cast<float>() / 255) * 2.0;
-      textureNormal = textureNormal.array() - 1;
-      Eigen::Vector3f faceTangent = mesh.faceTangents.row(pixel.face).cast<float>().normalized();
-      Eigen::Vector3f faceNormal = mesh.faceNormals.row(pixel.face).cast<float>().normalized();
-
-      Eigen::DiagonalMatrix<float, 3> diagMatrix(1, 1, 1);
-      Eigen::Matrix3f normalMatrix = diagMatrix.toDenseMatrix().inverse();
-
-      Eigen::Vector3f T = normalMatrix * faceTangent;
-      Eigen::Vector3f N = normalMatrix * faceNormal;
-      Eigen::Vector3f B = N.cross(T);
-
-      Eigen::Matrix3f TBN;
-      TBN.col(0) = T.normalized();
-      TBN.col(1) = B.normalized();
-      TBN.col(2) = N.normalized();
-
-      Eigen::Vector3f normal = (TBN * textureNormal.normalized()).normalized();
-
-      Eigen::Vector3f distance = normal - preferred.direction.normalized();
-      float norm = distance.norm();
-      float prefer = norm * preferred.strength;
-      int value = std::min(255.0f, addTexture[(4 * i) + 3] / prefer);
-      addTexture[(4 * i) + 3] = value;
-    }
-
-    float alpha = addTexture[(4 * i) + 3] / 255.0f;
-    texGroup.albedoData[(3 * i)] =
-        texGroup.albedoData[(3 * i)] * (1.0f - alpha) + addTexture[(4 * i)] * alpha;
-    texGroup.albedoData[(3 * i) + 1] =
-        texGroup.albedoData[(3 * i) + 1] * (1.0f - alpha) + addTexture[(4 * i) + 1] * alpha;
-    texGroup.albedoData[(3 * i) + 2] =
-        texGroup.albedoData[(3 * i) + 2] * (1.0f - alpha) + addTexture[(4 * i) + 2] * alpha;
-
-    if (!addGroup.displacementData.empty()) {
-      float displacementAlpha = displacementProportion * alpha;
-      texGroup.displacementData[i] = texGroup.displacementData[i] * (1.0f - displacementAlpha) +
-                                     addGroup.displacementData[i] * displacementAlpha;
-    }
-
-    if (!addGroup.normalData.empty()) {
-      float normalAlpha = normalProportion * alpha;
-      texGroup.normalData[(3 * i) + 0] = texGroup.normalData[(3 * i) + 0] * (1.0f - normalAlpha) +
-                                         addGroup.normalData[(3 * i) + 0] * normalAlpha;
-      texGroup.normalData[(3 * i) + 1] = texGroup.normalData[(3 * i) + 1] * (1.0f - normalAlpha) +
-                                         addGroup.normalData[(3 * i) + 1] * normalAlpha;
-      texGroup.normalData[(3 * i) + 2] = texGroup.normalData[(3 * i) + 2] * (1.0f - normalAlpha) +
-                                         addGroup.normalData[(3 * i) + 2] * normalAlpha;
-    }
-
-    if (!addGroup.roughnessData.empty()) {
-      float roughnessAlpha = roughnessProportion * alpha;
-      texGroup.roughnessData[i] = texGroup.roughnessData[i] * (1.0f - roughnessAlpha) +
-                                  addGroup.roughnessData[i] * roughnessAlpha;
-    }
-
-    if (!addGroup.metalData.empty()) {
-      float metalAlpha = metalProportion * alpha;
-      texGroup.metalData[i] =
-          texGroup.metalData[i] * (1.0f - metalAlpha) + addGroup.metalData[i] * metalAlpha;
+  if (addTexture.size() / 4 < texGroup.width * texGroup.height) return;  // nothing to add
+
+  // Only the channels the add group has are written, the others stay shared with the input mesh
+  auto& albedoData = texGroup.albedoData.write();
+  auto* displacementData =
+      addGroup.displacementData->empty() ? nullptr : &texGroup.displacementData.write();
+  auto* normalData = addGroup.normalData->empty() ? nullptr : &texGroup.normalData.write();
+  auto* roughnessData =
+      addGroup.roughnessData->empty() ? nullptr : &texGroup.roughnessData.write();
+  auto* metalData = addGroup.metalData->empty() ? nullptr : &texGroup.metalData.write();
+  auto* ambientOccData =
+      addGroup.ambientOccData->empty() ? nullptr : &texGroup.ambientOccData.write();
+
+  const auto& worldMap = *texGroup.worldMap;
+  const auto& textureNormals = *texGroup.normalData;
+  const auto& addDisplacement = *addGroup.displacementData;
+  const auto& addNormals = *addGroup.normalData;
+  const auto& addRoughness = *addGroup.roughnessData;
+  const auto& addMetal = *addGroup.metalData;
+  const auto& addAmbientOcc = *addGroup.ambientOccData;
+
+  const Eigen::Vector3f preferredDirection = preferred.direction.normalized();
+
+  // All channels of a tile are blended in one go, the tiles are independent of each other.
+  // Within a row the texels are blended in runs by the vectorized kernels.
+  utils::forEachTile(texGroup, [&](const TextureGroup::Tile& tile) {
+    float alphas[utils::textureTileSize];
+    float weights[3 * utils::textureTileSize];
+    unsigned char addColors[3 * utils::textureTileSize];
+
+    auto fillWeights = [&](float proportion, int channels, int count) {
+      for (int k = 0; k < count; k++) {
+        const float weight = proportion * alphas[k];
+        for (int c = 0; c < channels; c++) {
+          weights[(channels * k) + c] = weight;
+        }
+      }
+    };
+
+    auto blendRun = [&](int start, int count) {
+      for (int k = 0; k < count; k++) {
+        const int i = start + k;
+        alphas[k] = addTexture[(4 * i) + 3] / 255.0f;
+        for (int c = 0; c < 3; c++) {
+          addColors[(3 * k) + c] = addTexture[(4 * i) + c];
+        }
+      }
+
+      fillWeights(1.0f, 3, count);
+      utils::blendBytes(&albedoData[3 * start], addColors, weights, 3 * count);
+
+      if (displacementData != nullptr) {
+        fillWeights(displacementProportion, 1, count);
+        utils::blendFloats(&(*displacementData)[start], &addDisplacement[start], weights, count);
+      }
+
+      if (normalData != nullptr) {
+        fillWeights(normalProportion, 3, count);
+        utils::blendBytes(&(*normalData)[3 * start], &addNormals[3 * start], weights, 3 * count);
+      }
+
+      if (roughnessData != nullptr) {
+        fillWeights(roughnessProportion, 1, count);
+        utils::blendBytes(&(*roughnessData)[start], &addRoughness[start], weights, count);
+      }
+
+      if (metalData != nullptr) {
+        fillWeights(metalProportion, 1, count);
+        utils::blendBytes(&(*metalData)[start], &addMetal[start], weights, count);
+      }
+
+      if (ambientOccData != nullptr) {
+        fillWeights(ambientOccProportion, 1, count);
+        utils::blendBytes(&(*ambientOccData)[start], &addAmbientOcc[start], weights, count);
+      }
+    };
+
+    for (int y = tile.y; y < tile.y + tile.height; y++) {
+      const int rowBegin = (y * texGroup.width) + tile.x;
+      const int rowEnd = rowBegin + tile.width;
+
+      if (preferred.enabled) {
+        for (int i = rowBegin; i < rowEnd; i++) {
+          const int face = worldMap.faces[i];
+          if (face == -1) continue;
+
+          Eigen::Vector3i textureNormalSample = {textureNormals[(3 * i)],
+                                                 textureNormals[(3 * i) + 1],
+                                                 textureNormals[(3 * i) + 2]};
+          Eigen::Vector3f textureNormal = (textureNormalSample.cast<float>() / 255) * 2.0;
+          textureNormal = textureNormal.array() - 1;
+
+          Eigen::Vector3f normal =
+              (mesh.faceFrames[face] * textureNormal.normalized()).normalized();
+
+          Eigen::Vector3f distance = normal - preferredDirection;
+          float norm = distance.norm();
+          float prefer = norm * preferred.strength;
+          int value = std::min(255.0f, addTexture[(4 * i) + 3] / prefer);
+          addTexture[(4 * i) + 3] = value;
+        }
+      }
+
+      // Pixels on non faces are skipped when preferring directions
+      int begin = rowBegin;
+      while (begin < rowEnd) {
+        int end = rowEnd;
+        if (preferred.enabled) {
+          while (begin < rowEnd && worldMap.faces[begin] == -1) begin++;
+          end = begin;
+          while (end < rowEnd && worldMap.faces[end] != -1) end++;
+        }
+        blendRun(begin, end - begin);
+        begin = end;
+      }
     }
-
-    if (!addGroup.ambientOccData.empty()) {
-      float ambientOccAlpha = ambientOccProportion * alpha;
-      texGroup.ambientOccData[i] = texGroup.ambientOccData[i] * (1.0f - ambientOccAlpha) +
-                                   addGroup.ambientOccData[i] * ambientOccAlpha;
-    }
-  }
-}
-void TextureAdder::fillPart(std::vector<float>& data, int startIndex, int endIndex,
-                            const Mesh& mesh, TextureFunction texFunction,
-                            PreferredNormalDirectionStruct preferred) {
-  const auto& texGroup = mesh.textures;
-
-  for (int i = startIndex; i < endIndex; i++) {
-    const auto& pixel = texGroup.worldMap[i];
-
-    float acc = 0;
-    for (const auto& pos : pixel.positions) {
-      acc += texFunction(pos);
-    }
-
-    int index = i - startIndex;
-    acc /= pixel.positions.size();
-    data[index] = acc;
-  }
+  });
 }
 }  // namespace procrock
\ No newline at end of file
@@ -4,16 +4,13 @@
 #include <igl/barycentric_coordinates.h>
 
 #include <iostream>
-#include <thread>
-
-#include "utils/vector.h"
 
 namespace procrock {
 TextureGenerator::TextureGenerator() {}
 
 std::shared_ptr<Mesh> TextureGenerator::run(Mesh* before) {
   if (isChanged() || firstRun) {
-    mesh = generate(before);
+    mesh = runCached(before, [&]() { return generate(before); });
   }
 
   if (firstRun) firstRun = !firstRun;
@@ -0,0 +1,75 @@
+#include "texture_packing.h"
+
+#include "task_pool.h"
+
+namespace procrock {
+ChannelPacking ChannelPacking::orm() {
+  ChannelPacking packing;
+  packing.sources[0] = TextureGroup::AmbientOcc;
+  packing.sources[1] = TextureGroup::Roughness;
+  packing.sources[2] = TextureGroup::Metal;
+  packing.name = "orm";
+  return packing;
+}
+
+ChannelPacking ChannelPacking::rma() {
+  ChannelPacking packing;
+  packing.sources[0] = TextureGroup::Roughness;
+  packing.sources[1] = TextureGroup::Metal;
+  packing.sources[2] = TextureGroup::AmbientOcc;
+  packing.name = "rma";
+  return packing;
+}
+
+int ChannelPacking::getChannelCount() const { return sources[3] != 0 ? 4 : 3; }
+
+bool ChannelPacking::contains(unsigned int channel) const {
+  for (auto source : sources) {
+    if (source == channel) return true;
+  }
+  return false;
+}
+
+std::vector<unsigned char> packChannels(const TextureGroup& group, const ChannelPacking& packing) {
+  const int channels = packing.getChannelCount();
+  const int texelCount = group.width * group.height;
+  std::vector<unsigned char> packed((size_t)texelCount * channels);
+
+  for (int c = 0; c < channels; c++) {
+    const std::vector<unsigned char>* bytes = nullptr;
+    const std::vector<float>* floats = nullptr;
+    unsigned char fill = 0;
+    switch (packing.sources[c]) {
+      case TextureGroup::Roughness:
+        bytes = &*group.roughnessData;
+        fill = 255;
+        break;
+      case TextureGroup::Metal:
+        bytes = &*group.metalData;
+        break;
+      case TextureGroup::AmbientOcc:
+        bytes = &*group.ambientOccData;
+        fill = 255;
+        break;
+      case TextureGroup::Displacement:
+        floats = &*group.displacementData;
+        break;
+    }
+    if (bytes != nullptr && bytes->size() < texelCount) bytes = nullptr;
+    if (floats != nullptr && floats->size() < texelCount) floats = nullptr;
+
+    parallelFor(0, texelCount, 4096, [&](int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        if (bytes != nullptr) {
+          packed[(size_t)i * channels + c] = (*bytes)[i];
+        } else if (floats != nullptr) {
+          packed[(size_t)i * channels + c] = (*floats)[i] * 255;
+        } else {
+          packed[(size_t)i * channels + c] = fill;
+        }
+      }
+    });
+  }
+  return packed;
+}
+}  // namespace procrock
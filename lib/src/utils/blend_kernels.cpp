@@ -0,0 +1,36 @@
+#include "utils/blend_kernels.h"
+
+#include "utils/instruction_set.h"
+
+namespace procrock {
+namespace utils {
+void blendBytes(unsigned char* target, const unsigned char* source, const float* weights,
+                int count) {
+  int done = 0;
+#ifdef PROCROCK_SIMD
+  if (getInstructionSet() == InstructionSet::Avx2) {
+    done = avx2::blendBytes(target, source, weights, count);
+  } else if (getInstructionSet() == InstructionSet::Sse41) {
+    done = sse41::blendBytes(target, source, weights, count);
+  }
+#endif
+  for (int i = done; i < count; i++) {
+    target[i] = target[i] * (1.0f - weights[i]) + source[i] * weights[i];
+  }
+}
+
+void blendFloats(float* target, const float* source, const float* weights, int count) {
+  int done = 0;
+#ifdef PROCROCK_SIMD
+  if (getInstructionSet() == InstructionSet::Avx2) {
+    done = avx2::blendFloats(target, source, weights, count);
+  } else if (getInstructionSet() == InstructionSet::Sse41) {
+    done = sse41::blendFloats(target, source, weights, count);
+  }
+#endif
+  for (int i = done; i < count; i++) {
+    target[i] = target[i] * (1.0f - weights[i]) + source[i] * weights[i];
+  }
+}
+}  // namespace utils
+}  // namespace procrock
@@ -0,0 +1,29 @@
+#pragma once
+
+namespace procrock {
+namespace utils {
+// Alpha blending of texture data, every value becomes target * (1 - weight) + source * weight
+// with its own weight. Byte results are truncated like the scalar float to byte conversion, so
+// every instruction set gives exactly the same output.
+// Depending on the cpu, they run vectorized with AVX2 or SSE4.1 and fall back to scalar code.
+void blendBytes(unsigned char* target, const unsigned char* source, const float* weights,
+                int count);
+void blendFloats(float* target, const float* source, const float* weights, int count);
+
+#ifdef PROCROCK_SIMD
+// Vectorized kernels, they blend as many values as fit into full vectors and return how many
+// that were
+namespace avx2 {
+int blendBytes(unsigned char* target, const unsigned char* source, const float* weights,
+               int count);
+int blendFloats(float* target, const float* source, const float* weights, int count);
+}  // namespace avx2
+
+namespace sse41 {
+int blendBytes(unsigned char* target, const unsigned char* source, const float* weights,
+               int count);
+int blendFloats(float* target, const float* source, const float* weights, int count);
+}  // namespace sse41
+#endif
+}  // namespace utils
+}  // namespace procrock
@@ -0,0 +1,61 @@
+// Compiled with AVX2 enabled, only called after checking the cpu supports it
+#ifdef PROCROCK_SIMD
+#include <immintrin.h>
+
+#include "utils/blend_kernels.h"
+
+namespace procrock {
+namespace utils {
+namespace avx2 {
+namespace {
+// Blends eight bytes given as 32 bit integers, the result keeps only the lowest byte of the
+// truncated value like the scalar conversion
+inline __m256i blend(__m256i target, __m256i source, const float* weights) {
+  const __m256 weight = _mm256_loadu_ps(weights);
+  const __m256 result = _mm256_add_ps(
+      _mm256_mul_ps(_mm256_cvtepi32_ps(target), _mm256_sub_ps(_mm256_set1_ps(1.0f), weight)),
+      _mm256_mul_ps(_mm256_cvtepi32_ps(source), weight));
+  return _mm256_and_si256(_mm256_cvttps_epi32(result), _mm256_set1_epi32(0xff));
+}
+}  // namespace
+
+int blendBytes(unsigned char* target, const unsigned char* source, const float* weights,
+               int count) {
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m128i targetBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(target + i));
+    const __m128i sourceBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+
+    const __m256i low = blend(_mm256_cvtepu8_epi32(targetBytes),
+                              _mm256_cvtepu8_epi32(sourceBytes), weights + i);
+    const __m256i high =
+        blend(_mm256_cvtepu8_epi32(_mm_srli_si128(targetBytes, 8)),
+              _mm256_cvtepu8_epi32(_mm_srli_si128(sourceBytes, 8)), weights + i + 8);
+
+    // all values are bytes already, the packs do not saturate anything. The 256 bit pack works
+    // per 128 bit lane, the permutation restores the order.
+    const __m256i words =
+        _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), _MM_SHUFFLE(3, 1, 2, 0));
+    const __m128i bytes =
+        _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), bytes);
+  }
+  return i;
+}
+
+int blendFloats(float* target, const float* source, const float* weights, int count) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256 weight = _mm256_loadu_ps(weights + i);
+    const __m256 result =
+        _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(target + i), _mm256_sub_ps(one, weight)),
+                      _mm256_mul_ps(_mm256_loadu_ps(source + i), weight));
+    _mm256_storeu_ps(target + i, result);
+  }
+  return i;
+}
+}  // namespace avx2
+}  // namespace utils
+}  // namespace procrock
+#endif
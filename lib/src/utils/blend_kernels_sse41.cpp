@@ -0,0 +1,63 @@
+// Compiled with SSE4.1 enabled, only called after checking the cpu supports it
+#ifdef PROCROCK_SIMD
+#include <smmintrin.h>
+
+#include "utils/blend_kernels.h"
+
+namespace procrock {
+namespace utils {
+namespace sse41 {
+namespace {
+// Blends four bytes given as 32 bit integers, the result keeps only the lowest byte of the
+// truncated value like the scalar conversion
+inline __m128i blend(__m128i target, __m128i source, const float* weights) {
+  const __m128 weight = _mm_loadu_ps(weights);
+  const __m128 result =
+      _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(target), _mm_sub_ps(_mm_set1_ps(1.0f), weight)),
+                 _mm_mul_ps(_mm_cvtepi32_ps(source), weight));
+  return _mm_and_si128(_mm_cvttps_epi32(result), _mm_set1_epi32(0xff));
+}
+}  // namespace
+
+int blendBytes(unsigned char* target, const unsigned char* source, const float* weights,
+               int count) {
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m128i targetBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(target + i));
+    const __m128i sourceBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+
+    const __m128i first = blend(_mm_cvtepu8_epi32(targetBytes), _mm_cvtepu8_epi32(sourceBytes),
+                                weights + i);
+    const __m128i second =
+        blend(_mm_cvtepu8_epi32(_mm_srli_si128(targetBytes, 4)),
+              _mm_cvtepu8_epi32(_mm_srli_si128(sourceBytes, 4)), weights + i + 4);
+    const __m128i third =
+        blend(_mm_cvtepu8_epi32(_mm_srli_si128(targetBytes, 8)),
+              _mm_cvtepu8_epi32(_mm_srli_si128(sourceBytes, 8)), weights + i + 8);
+    const __m128i fourth =
+        blend(_mm_cvtepu8_epi32(_mm_srli_si128(targetBytes, 12)),
+              _mm_cvtepu8_epi32(_mm_srli_si128(sourceBytes, 12)), weights + i + 12);
+
+    // all values are bytes already, the packs do not saturate anything
+    const __m128i bytes =
+        _mm_packus_epi16(_mm_packus_epi32(first, second), _mm_packus_epi32(third, fourth));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), bytes);
+  }
+  return i;
+}
+
+int blendFloats(float* target, const float* source, const float* weights, int count) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128 weight = _mm_loadu_ps(weights + i);
+    const __m128 result = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(target + i), _mm_sub_ps(one, weight)),
+                                     _mm_mul_ps(_mm_loadu_ps(source + i), weight));
+    _mm_storeu_ps(target + i, result);
+  }
+  return i;
+}
+}  // namespace sse41
+}  // namespace utils
+}  // namespace procrock
+#endif
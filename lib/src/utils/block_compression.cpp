@@ -0,0 +1,315 @@
+#include "utils/block_compression.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace procrock {
+namespace utils {
+namespace {
+const int blockTexels = 16;
+const int refineIterations = 2;
+
+// Share of the first endpoint in the palette colors of a BC1 block
+const float bc1Shares[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+// Interpolation weights of the second endpoint for BC7's 4 bit indices, out of 64
+const int bc7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+inline float clampColor(float value) { return std::min(255.0f, std::max(0.0f, value)); }
+
+// Fits a line through the texel colors along their principal axis, found by power iteration on
+// their covariance, and returns the ends of the colors projected onto it.
+template <int Dims>
+void fitEndpoints(const unsigned char* rgba, float* start, float* end) {
+  float mean[Dims] = {};
+  for (int i = 0; i < blockTexels; i++) {
+    for (int d = 0; d < Dims; d++) mean[d] += rgba[4 * i + d];
+  }
+  for (int d = 0; d < Dims; d++) mean[d] /= blockTexels;
+
+  float covariance[Dims][Dims] = {};
+  for (int i = 0; i < blockTexels; i++) {
+    for (int a = 0; a < Dims; a++) {
+      for (int b = 0; b < Dims; b++) {
+        covariance[a][b] += (rgba[4 * i + a] - mean[a]) * (rgba[4 * i + b] - mean[b]);
+      }
+    }
+  }
+
+  // Starting from the row of the largest variance, the start is never orthogonal to the axis
+  int largest = 0;
+  for (int d = 1; d < Dims; d++) {
+    if (covariance[d][d] > covariance[largest][largest]) largest = d;
+  }
+  float axis[Dims];
+  for (int d = 0; d < Dims; d++) axis[d] = covariance[largest][d];
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float next[Dims] = {};
+    float length = 0.0f;
+    for (int a = 0; a < Dims; a++) {
+      for (int b = 0; b < Dims; b++) next[a] += covariance[a][b] * axis[b];
+      length = std::max(length, std::abs(next[a]));
+    }
+    if (length < 1e-6f) break;
+    for (int d = 0; d < Dims; d++) axis[d] = next[d] / length;
+  }
+
+  float length = 0.0f;
+  for (int d = 0; d < Dims; d++) length += axis[d] * axis[d];
+  length = std::sqrt(length);
+  if (length < 1e-6f) {  // all texels have the same color
+    for (int d = 0; d < Dims; d++) start[d] = end[d] = mean[d];
+    return;
+  }
+  for (int d = 0; d < Dims; d++) axis[d] /= length;
+
+  float minProjection = FLT_MAX, maxProjection = -FLT_MAX;
+  for (int i = 0; i < blockTexels; i++) {
+    float projection = 0.0f;
+    for (int d = 0; d < Dims; d++) projection += (rgba[4 * i + d] - mean[d]) * axis[d];
+    minProjection = std::min(minProjection, projection);
+    maxProjection = std::max(maxProjection, projection);
+  }
+  for (int d = 0; d < Dims; d++) {
+    start[d] = clampColor(mean[d] + axis[d] * minProjection);
+    end[d] = clampColor(mean[d] + axis[d] * maxProjection);
+  }
+}
+
+// Endpoints with the least squared error for fixed palette entries of the texels, given as the
+// share of the first endpoint. Returns false if they are not unique.
+template <int Dims>
+bool solveEndpoints(const unsigned char* rgba, const float* shares, float* start, float* end) {
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[Dims] = {}, bx[Dims] = {};
+  for (int i = 0; i < blockTexels; i++) {
+    float a = shares[i];
+    float b = 1.0f - a;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int d = 0; d < Dims; d++) {
+      ax[d] += a * rgba[4 * i + d];
+      bx[d] += b * rgba[4 * i + d];
+    }
+  }
+
+  float determinant = aa * bb - ab * ab;
+  if (std::abs(determinant) < 1e-6f) return false;
+  for (int d = 0; d < Dims; d++) {
+    start[d] = clampColor((ax[d] * bb - bx[d] * ab) / determinant);
+    end[d] = clampColor((bx[d] * aa - ax[d] * ab) / determinant);
+  }
+  return true;
+}
+
+struct BC1Block {
+  int colors[2];
+  int indices[blockTexels];
+  int error;
+};
+
+int toRgb565(const float* color) {
+  int r = (int)std::lround(color[0] * 31.0f / 255.0f);
+  int g = (int)std::lround(color[1] * 63.0f / 255.0f);
+  int b = (int)std::lround(color[2] * 31.0f / 255.0f);
+  return (r << 11) | (g << 5) | b;
+}
+
+void fromRgb565(int color, int* rgb) {
+  int r = (color >> 11) & 31;
+  int g = (color >> 5) & 63;
+  int b = color & 31;
+  rgb[0] = (r << 3) | (r >> 2);
+  rgb[1] = (g << 2) | (g >> 4);
+  rgb[2] = (b << 3) | (b >> 2);
+}
+
+BC1Block encodeBC1(const unsigned char* rgba, const float* start, const float* end) {
+  BC1Block block;
+  block.colors[0] = toRgb565(start);
+  block.colors[1] = toRgb565(end);
+  // The first color has to be the larger one, equal ones switch to the 3 color mode where only
+  // the first entry of the palette is the same
+  if (block.colors[0] < block.colors[1]) std::swap(block.colors[0], block.colors[1]);
+  const int paletteSize = block.colors[0] == block.colors[1] ? 1 : 4;
+
+  int palette[4][3];
+  fromRgb565(block.colors[0], palette[0]);
+  fromRgb565(block.colors[1], palette[1]);
+  for (int c = 0; c < 3; c++) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+
+  block.error = 0;
+  for (int i = 0; i < blockTexels; i++) {
+    int bestError = INT_MAX;
+    for (int k = 0; k < paletteSize; k++) {
+      int error = 0;
+      for (int c = 0; c < 3; c++) {
+        int diff = rgba[4 * i + c] - palette[k][c];
+        error += diff * diff;
+      }
+      if (error < bestError) {
+        bestError = error;
+        block.indices[i] = k;
+      }
+    }
+    block.error += bestError;
+  }
+  return block;
+}
+
+struct BC7Block {
+  int endpoints[2][4];  // 7 bits per channel
+  int pBits[2];
+  int indices[blockTexels];
+  int error;
+};
+
+// Every endpoint shares one lowest bit over its channels, the one that fits better is taken
+void quantizeBC7(const float* color, int* endpoint, int& pBit) {
+  float bestError = FLT_MAX;
+  for (int p = 0; p < 2; p++) {
+    int quantized[4];
+    float error = 0.0f;
+    for (int c = 0; c < 4; c++) {
+      quantized[c] = std::min(127, std::max(0, (int)std::lround((color[c] - p) / 2.0f)));
+      float diff = quantized[c] * 2 + p - color[c];
+      error += diff * diff;
+    }
+    if (error < bestError) {
+      bestError = error;
+      pBit = p;
+      std::copy(quantized, quantized + 4, endpoint);
+    }
+  }
+}
+
+BC7Block encodeBC7(const unsigned char* rgba, const float* start, const float* end) {
+  BC7Block block;
+  quantizeBC7(start, block.endpoints[0], block.pBits[0]);
+  quantizeBC7(end, block.endpoints[1], block.pBits[1]);
+
+  int palette[16][4];
+  for (int c = 0; c < 4; c++) {
+    int first = block.endpoints[0][c] * 2 + block.pBits[0];
+    int second = block.endpoints[1][c] * 2 + block.pBits[1];
+    for (int k = 0; k < 16; k++) {
+      palette[k][c] = ((64 - bc7Weights[k]) * first + bc7Weights[k] * second + 32) >> 6;
+    }
+  }
+
+  block.error = 0;
+  for (int i = 0; i < blockTexels; i++) {
+    int bestError = INT_MAX;
+    for (int k = 0; k < 16; k++) {
+      int error = 0;
+      for (int c = 0; c < 4; c++) {
+        int diff = rgba[4 * i + c] - palette[k][c];
+        error += diff * diff;
+      }
+      if (error < bestError) {
+        bestError = error;
+        block.indices[i] = k;
+      }
+    }
+    block.error += bestError;
+  }
+  return block;
+}
+
+struct BitWriter {
+  unsigned char* out;
+  int position = 0;
+
+  void write(int value, int count) {
+    for (int bit = 0; bit < count; bit++, position++) {
+      if ((value >> bit) & 1) out[position >> 3] |= 1 << (position & 7);
+    }
+  }
+};
+}  // namespace
+
+void compressBlockBC1(const unsigned char* rgba, unsigned char* out) {
+  float start[3], end[3];
+  fitEndpoints<3>(rgba, start, end);
+  BC1Block best = encodeBC1(rgba, start, end);
+
+  for (int iteration = 0; iteration < refineIterations && best.error > 0; iteration++) {
+    float shares[blockTexels];
+    for (int i = 0; i < blockTexels; i++) shares[i] = bc1Shares[best.indices[i]];
+    if (!solveEndpoints<3>(rgba, shares, start, end)) break;
+    BC1Block refined = encodeBC1(rgba, start, end);
+    if (refined.error >= best.error) break;
+    best = refined;
+  }
+
+  unsigned int indexBits = 0;
+  for (int i = 0; i < blockTexels; i++) indexBits |= best.indices[i] << (2 * i);
+  for (int b = 0; b < 2; b++) {
+    out[b] = (best.colors[0] >> (8 * b)) & 0xff;
+    out[2 + b] = (best.colors[1] >> (8 * b)) & 0xff;
+  }
+  for (int b = 0; b < 4; b++) out[4 + b] = (indexBits >> (8 * b)) & 0xff;
+}
+
+void compressBlockBC4(const unsigned char* values, unsigned char* out) {
+  // The largest value first selects the mode with six interpolated values
+  const int max = *std::max_element(values, values + blockTexels);
+  const int min = *std::min_element(values, values + blockTexels);
+  int palette[8] = {max, min};
+  for (int k = 2; k < 8; k++) palette[k] = ((8 - k) * max + (k - 1) * min + 3) / 7;
+
+  unsigned long long indexBits = 0;
+  for (int i = 0; i < blockTexels && max != min; i++) {
+    int index = 0;
+    for (int k = 1; k < 8; k++) {
+      if (std::abs(values[i] - palette[k]) < std::abs(values[i] - palette[index])) index = k;
+    }
+    indexBits |= (unsigned long long)index << (3 * i);
+  }
+
+  out[0] = max;
+  out[1] = min;
+  for (int b = 0; b < 6; b++) out[2 + b] = (indexBits >> (8 * b)) & 0xff;
+}
+
+void compressBlockBC7(const unsigned char* rgba, unsigned char* out) {
+  float start[4], end[4];
+  fitEndpoints<4>(rgba, start, end);
+  BC7Block best = encodeBC7(rgba, start, end);
+
+  for (int iteration = 0; iteration < refineIterations && best.error > 0; iteration++) {
+    float shares[blockTexels];
+    for (int i = 0; i < blockTexels; i++) shares[i] = 1.0f - bc7Weights[best.indices[i]] / 64.0f;
+    if (!solveEndpoints<4>(rgba, shares, start, end)) break;
+    BC7Block refined = encodeBC7(rgba, start, end);
+    if (refined.error >= best.error) break;
+    best = refined;
+  }
+
+  // The highest index bit of the first texel is implied to be zero
+  if (best.indices[0] >= 8) {
+    std::swap(best.endpoints[0], best.endpoints[1]);
+    std::swap(best.pBits[0], best.pBits[1]);
+    for (int i = 0; i < blockTexels; i++) best.indices[i] = 15 - best.indices[i];
+  }
+
+  std::memset(out, 0, 16);
+  BitWriter writer{out};
+  writer.write(1 << 6, 7);  // mode 6
+  for (int c = 0; c < 4; c++) {
+    writer.write(best.endpoints[0][c], 7);
+    writer.write(best.endpoints[1][c], 7);
+  }
+  writer.write(best.pBits[0], 1);
+  writer.write(best.pBits[1], 1);
+  for (int i = 0; i < blockTexels; i++) writer.write(best.indices[i], i == 0 ? 3 : 4);
+}
+}  // namespace utils
+}  // namespace procrock
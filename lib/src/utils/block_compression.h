@@ -0,0 +1,21 @@
+#pragma once
+
+namespace procrock {
+namespace utils {
+// Compress one block of 4x4 texels, given row by row, into the block formats gpus sample
+// directly. BC1 and BC7 read rgba texels, BC4 reads one value per texel. BC5 is a BC4 block of
+// the red values followed by one of the green values.
+// The endpoints are fitted along the principal axis of the block's colors and refined by least
+// squares on the chosen indices.
+
+// Writes 8 bytes, opaque 4 color mode only
+void compressBlockBC1(const unsigned char* rgba, unsigned char* out);
+
+// Writes 8 bytes
+void compressBlockBC4(const unsigned char* values, unsigned char* out);
+
+// Writes 16 bytes. Only mode 6 (one subset, 7 bit endpoints, 4 bit indices) is searched, which
+// keeps smooth gradients and is a lot faster than trying all eight modes.
+void compressBlockBC7(const unsigned char* rgba, unsigned char* out);
+}  // namespace utils
+}  // namespace procrock
@@ -0,0 +1,43 @@
+#include "utils/convert_kernels.h"
+
+#include <algorithm>
+
+#include "utils/instruction_set.h"
+
+namespace procrock {
+namespace utils {
+namespace {
+inline float clampUnit(float value) { return std::min(1.0f, std::max(0.0f, value)); }
+}  // namespace
+
+void floatsToBytes(const float* source, unsigned char* target, int count) {
+  int done = 0;
+#ifdef PROCROCK_SIMD
+  if (getInstructionSet() == InstructionSet::Avx2) {
+    done = avx2::floatsToBytes(source, target, count);
+  } else if (getInstructionSet() == InstructionSet::Sse41) {
+    done = sse41::floatsToBytes(source, target, count);
+  }
+#endif
+  for (int i = done; i < count; i++) {
+    target[i] = (int)(clampUnit(source[i]) * 255.0f);
+  }
+}
+
+void floatsToBigEndianWords(const float* source, unsigned char* target, int count) {
+  int done = 0;
+#ifdef PROCROCK_SIMD
+  if (getInstructionSet() == InstructionSet::Avx2) {
+    done = avx2::floatsToBigEndianWords(source, target, count);
+  } else if (getInstructionSet() == InstructionSet::Sse41) {
+    done = sse41::floatsToBigEndianWords(source, target, count);
+  }
+#endif
+  for (int i = done; i < count; i++) {
+    const int word = (int)(clampUnit(source[i]) * 65535.0f + 0.5f);
+    target[2 * i] = word >> 8;
+    target[2 * i + 1] = word & 0xff;
+  }
+}
+}  // namespace utils
+}  // namespace procrock
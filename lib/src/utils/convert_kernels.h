@@ -0,0 +1,27 @@
+#pragma once
+
+namespace procrock {
+namespace utils {
+// Conversion of float texture data in [0, 1] to the integers of image files, values outside are
+// clamped. Bytes are truncated like the float to byte conversion of the texture stages, 16 bit
+// values are rounded and stored big endian as png wants them.
+// Depending on the cpu, they run vectorized with AVX2 or SSE4.1 and fall back to scalar code,
+// all give exactly the same output.
+void floatsToBytes(const float* source, unsigned char* target, int count);
+void floatsToBigEndianWords(const float* source, unsigned char* target, int count);
+
+#ifdef PROCROCK_SIMD
+// Vectorized kernels, they convert as many values as fit into full vectors and return how many
+// that were
+namespace avx2 {
+int floatsToBytes(const float* source, unsigned char* target, int count);
+int floatsToBigEndianWords(const float* source, unsigned char* target, int count);
+}  // namespace avx2
+
+namespace sse41 {
+int floatsToBytes(const float* source, unsigned char* target, int count);
+int floatsToBigEndianWords(const float* source, unsigned char* target, int count);
+}  // namespace sse41
+#endif
+}  // namespace utils
+}  // namespace procrock
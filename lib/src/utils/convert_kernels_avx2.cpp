@@ -0,0 +1,54 @@
+// Compiled with AVX2 enabled, only called after checking the cpu supports it
+#ifdef PROCROCK_SIMD
+#include <immintrin.h>
+
+#include "utils/convert_kernels.h"
+
+namespace procrock {
+namespace utils {
+namespace avx2 {
+namespace {
+// Clamps eight floats to [0, 1], maps them to [0, scale] and truncates them to 32 bit integers
+inline __m256i convert(const float* source, float scale, float offset) {
+  const __m256 clamped = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(source), _mm256_setzero_ps()),
+                                       _mm256_set1_ps(1.0f));
+  return _mm256_cvttps_epi32(
+      _mm256_add_ps(_mm256_mul_ps(clamped, _mm256_set1_ps(scale)), _mm256_set1_ps(offset)));
+}
+
+// The 256 bit pack works per 128 bit lane, the permutation restores the order
+inline __m256i packWords(__m256i low, __m256i high) {
+  return _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), _MM_SHUFFLE(3, 1, 2, 0));
+}
+}  // namespace
+
+int floatsToBytes(const float* source, unsigned char* target, int count) {
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    // all values are bytes already, the packs do not saturate anything
+    const __m256i words =
+        packWords(convert(source + i, 255.0f, 0.0f), convert(source + i + 8, 255.0f, 0.0f));
+    const __m128i bytes =
+        _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), bytes);
+  }
+  return i;
+}
+
+int floatsToBigEndianWords(const float* source, unsigned char* target, int count) {
+  const __m256i swapBytes =
+      _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7,
+                       6, 9, 8, 11, 10, 13, 12, 15, 14);
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m256i words = packWords(convert(source + i, 65535.0f, 0.5f),
+                                    convert(source + i + 8, 65535.0f, 0.5f));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(target + 2 * i),
+                        _mm256_shuffle_epi8(words, swapBytes));
+  }
+  return i;
+}
+}  // namespace avx2
+}  // namespace utils
+}  // namespace procrock
+#endif
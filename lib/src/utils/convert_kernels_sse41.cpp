@@ -0,0 +1,46 @@
+// Compiled with SSE4.1 enabled, only called after checking the cpu supports it
+#ifdef PROCROCK_SIMD
+#include <smmintrin.h>
+
+#include "utils/convert_kernels.h"
+
+namespace procrock {
+namespace utils {
+namespace sse41 {
+namespace {
+// Clamps four floats to [0, 1], maps them to [0, scale] and truncates them to 32 bit integers
+inline __m128i convert(const float* source, float scale, float offset) {
+  const __m128 clamped =
+      _mm_min_ps(_mm_max_ps(_mm_loadu_ps(source), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+  return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, _mm_set1_ps(scale)), _mm_set1_ps(offset)));
+}
+}  // namespace
+
+int floatsToBytes(const float* source, unsigned char* target, int count) {
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    // all values are bytes already, the packs do not saturate anything
+    const __m128i low = _mm_packus_epi32(convert(source + i, 255.0f, 0.0f),
+                                         convert(source + i + 4, 255.0f, 0.0f));
+    const __m128i high = _mm_packus_epi32(convert(source + i + 8, 255.0f, 0.0f),
+                                          convert(source + i + 12, 255.0f, 0.0f));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), _mm_packus_epi16(low, high));
+  }
+  return i;
+}
+
+int floatsToBigEndianWords(const float* source, unsigned char* target, int count) {
+  const __m128i swapBytes = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i words = _mm_packus_epi32(convert(source + i, 65535.0f, 0.5f),
+                                           convert(source + i + 4, 65535.0f, 0.5f));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 2 * i),
+                     _mm_shuffle_epi8(words, swapBytes));
+  }
+  return i;
+}
+}  // namespace sse41
+}  // namespace utils
+}  // namespace procrock
+#endif
@@ -0,0 +1,205 @@
+#include "utils/dds_writer.h"
+
+#include <procrocklib/task_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+#include "utils/block_compression.h"
+
+namespace procrock {
+namespace utils {
+namespace {
+const unsigned int headerSize = 124;
+const unsigned int pixelFormatSize = 32;
+
+// Flags of the dds header, see DDS_HEADER and DDS_PIXELFORMAT
+const unsigned int headerFlags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+const unsigned int pixelFormatFourCC = 0x4;
+const unsigned int capsFlags = 0x8 | 0x1000 | 0x400000;  // complex, texture, mip map
+
+// BC7 only exists with the DX10 header extension
+const unsigned int dxgiFormatBC7 = 98;
+const unsigned int dimensionTexture2D = 3;
+
+const int rowsPerTask = 16;
+
+void appendUint32(std::vector<unsigned char>& bytes, unsigned int value) {
+  bytes.push_back(value & 0xff);
+  bytes.push_back((value >> 8) & 0xff);
+  bytes.push_back((value >> 16) & 0xff);
+  bytes.push_back((value >> 24) & 0xff);
+}
+
+unsigned int getFourCC(BlockFormat format) {
+  const char* codes[4] = {"DXT1", "ATI1", "ATI2", "DX10"};
+  const char* code = codes[(int)format];
+  return code[0] | (code[1] << 8) | (code[2] << 16) | (code[3] << 24);
+}
+
+int getBlockBytes(BlockFormat format) {
+  return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+struct MipLevel {
+  int width, height;
+  std::vector<unsigned char> rgba;
+};
+
+// BC5 only keeps x and y of a normal and z is reconstructed from them, which only works for
+// normals of unit length
+void storeNormal(float x, float y, float z, unsigned char* texel) {
+  float length = std::sqrt(x * x + y * y + z * z);
+  if (length < 1e-6f) {
+    x = y = 0.0f;
+    z = length = 1.0f;
+  }
+  texel[0] = (int)std::lround((x / length * 0.5f + 0.5f) * 255.0f);
+  texel[1] = (int)std::lround((y / length * 0.5f + 0.5f) * 255.0f);
+  texel[2] = (int)std::lround((z / length * 0.5f + 0.5f) * 255.0f);
+}
+
+inline float loadNormal(unsigned char value) { return value / 255.0f * 2.0f - 1.0f; }
+
+MipLevel createFirstLevel(int width, int height, int channels, const unsigned char* data,
+                          bool normalMap, bool flipVertically) {
+  MipLevel level{width, height};
+  level.rgba.resize((size_t)width * height * 4);
+  parallelFor(0, height, rowsPerTask, [&](int begin, int end) {
+    for (int y = begin; y < end; y++) {
+      const unsigned char* source =
+          data + (size_t)(flipVertically ? height - 1 - y : y) * width * channels;
+      unsigned char* target = &level.rgba[(size_t)y * width * 4];
+      for (int x = 0; x < width; x++, source += channels, target += 4) {
+        for (int c = 0; c < 4; c++) target[c] = c < channels ? source[c] : (c == 3 ? 255 : 0);
+        if (normalMap) {
+          storeNormal(loadNormal(target[0]), loadNormal(target[1]), loadNormal(target[2]),
+                      target);
+        }
+      }
+    }
+  });
+  return level;
+}
+
+// Averages 2x2 texels, odd sizes repeat their last row or column
+MipLevel downsample(const MipLevel& level, bool normalMap) {
+  MipLevel smaller{std::max(1, level.width / 2), std::max(1, level.height / 2)};
+  smaller.rgba.resize((size_t)smaller.width * smaller.height * 4);
+  parallelFor(0, smaller.height, rowsPerTask, [&](int begin, int end) {
+    for (int y = begin; y < end; y++) {
+      for (int x = 0; x < smaller.width; x++) {
+        const unsigned char* sources[4];
+        for (int s = 0; s < 4; s++) {
+          int sourceX = std::min(2 * x + (s & 1), level.width - 1);
+          int sourceY = std::min(2 * y + (s >> 1), level.height - 1);
+          sources[s] = &level.rgba[((size_t)sourceY * level.width + sourceX) * 4];
+        }
+
+        unsigned char* target = &smaller.rgba[((size_t)y * smaller.width + x) * 4];
+        for (int c = 0; c < 4; c++) {
+          target[c] = (sources[0][c] + sources[1][c] + sources[2][c] + sources[3][c] + 2) / 4;
+        }
+        if (normalMap) {
+          float normal[3] = {0.0f, 0.0f, 0.0f};
+          for (int s = 0; s < 4; s++) {
+            for (int c = 0; c < 3; c++) normal[c] += loadNormal(sources[s][c]);
+          }
+          storeNormal(normal[0], normal[1], normal[2], target);
+        }
+      }
+    }
+  });
+  return smaller;
+}
+
+std::vector<unsigned char> compressLevel(const MipLevel& level, BlockFormat format) {
+  const int blocksX = (level.width + 3) / 4;
+  const int blocksY = (level.height + 3) / 4;
+  const int blockBytes = getBlockBytes(format);
+  std::vector<unsigned char> blocks((size_t)blocksX * blocksY * blockBytes);
+
+  parallelFor(0, blocksY, 1, [&](int begin, int end) {
+    unsigned char rgba[16 * 4];
+    unsigned char values[16];
+    for (int blockY = begin; blockY < end; blockY++) {
+      for (int blockX = 0; blockX < blocksX; blockX++) {
+        // Blocks over the border of the level repeat its last texels
+        for (int i = 0; i < 16; i++) {
+          int x = std::min(4 * blockX + (i & 3), level.width - 1);
+          int y = std::min(4 * blockY + (i >> 2), level.height - 1);
+          std::copy_n(&level.rgba[((size_t)y * level.width + x) * 4], 4, &rgba[4 * i]);
+        }
+
+        unsigned char* out = &blocks[((size_t)blockY * blocksX + blockX) * blockBytes];
+        switch (format) {
+          case BlockFormat::BC1:
+            compressBlockBC1(rgba, out);
+            break;
+          case BlockFormat::BC7:
+            compressBlockBC7(rgba, out);
+            break;
+          case BlockFormat::BC4:
+          case BlockFormat::BC5:
+            for (int c = 0; c < (format == BlockFormat::BC5 ? 2 : 1); c++) {
+              for (int i = 0; i < 16; i++) values[i] = rgba[4 * i + c];
+              compressBlockBC4(values, out + 8 * c);
+            }
+            break;
+        }
+      }
+    }
+  });
+  return blocks;
+}
+}  // namespace
+
+bool writeDds(const std::string& filePath, BlockFormat format, int width, int height,
+              int channels, const unsigned char* data, bool normalMap, bool flipVertically) {
+  if (width <= 0 || height <= 0 || channels < 1 || channels > 4) return false;
+
+  std::ofstream file(filePath, std::ios::binary);
+  if (!file) return false;
+  auto writeBytes = [&](const std::vector<unsigned char>& bytes) {
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  };
+
+  int mipCount = 1;
+  while ((std::max(width, height) >> mipCount) > 0) mipCount++;
+
+  std::vector<unsigned char> header = {'D', 'D', 'S', ' '};
+  appendUint32(header, headerSize);
+  appendUint32(header, headerFlags);
+  appendUint32(header, height);
+  appendUint32(header, width);
+  appendUint32(header, ((width + 3) / 4) * ((height + 3) / 4) * getBlockBytes(format));
+  appendUint32(header, 0);  // depth
+  appendUint32(header, mipCount);
+  for (int i = 0; i < 11; i++) appendUint32(header, 0);
+  appendUint32(header, pixelFormatSize);
+  appendUint32(header, pixelFormatFourCC);
+  appendUint32(header, getFourCC(format));
+  for (int i = 0; i < 5; i++) appendUint32(header, 0);  // bit count and masks
+  appendUint32(header, capsFlags);
+  for (int i = 0; i < 4; i++) appendUint32(header, 0);
+  if (format == BlockFormat::BC7) {
+    appendUint32(header, dxgiFormatBC7);
+    appendUint32(header, dimensionTexture2D);
+    appendUint32(header, 0);  // misc flags
+    appendUint32(header, 1);  // array size
+    appendUint32(header, 0);  // alpha mode unknown
+  }
+  writeBytes(header);
+
+  // Only the level in work and the next smaller one are held in memory
+  MipLevel level = createFirstLevel(width, height, channels, data, normalMap, flipVertically);
+  for (int mip = 0; mip < mipCount; mip++) {
+    if (mip > 0) level = downsample(level, normalMap);
+    writeBytes(compressLevel(level, format));
+  }
+  return bool(file);
+}
+}  // namespace utils
+}  // namespace procrock
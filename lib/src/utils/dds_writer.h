@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+
+namespace procrock {
+namespace utils {
+enum class BlockFormat { BC1, BC4, BC5, BC7 };
+
+// Writes a block compressed dds file with the full mip chain. The data has 1 to 4 channels per
+// texel, BC4 compresses the first channel and BC5 the first two. Normal maps are normalized in
+// every mip level, as BC5 drops their z.
+// The mip levels are box filtered and their blocks are compressed in parallel.
+// Returns false if the file could not be written.
+bool writeDds(const std::string& filePath, BlockFormat format, int width, int height,
+              int channels, const unsigned char* data, bool normalMap = false,
+              bool flipVertically = false);
+}  // namespace utils
+}  // namespace procrock
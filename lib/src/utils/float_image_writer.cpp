@@ -0,0 +1,114 @@
+#include "utils/float_image_writer.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace procrock {
+namespace utils {
+namespace {
+const unsigned int exrPixelTypeFloat = 2;
+
+void appendUint32(std::vector<unsigned char>& bytes, unsigned int value) {
+  for (int b = 0; b < 4; b++) bytes.push_back((value >> (8 * b)) & 0xff);
+}
+
+void appendUint64(std::vector<unsigned char>& bytes, unsigned long long value) {
+  for (int b = 0; b < 8; b++) bytes.push_back((value >> (8 * b)) & 0xff);
+}
+
+void appendFloats(std::vector<unsigned char>& bytes, const float* values, int count) {
+  for (int i = 0; i < count; i++) {
+    unsigned int bits;
+    std::memcpy(&bits, &values[i], sizeof(bits));
+    appendUint32(bytes, bits);
+  }
+}
+
+// Name, type, size and value of an exr header attribute
+void appendAttribute(std::vector<unsigned char>& bytes, const std::string& name,
+                     const std::string& type, const std::vector<unsigned char>& value) {
+  bytes.insert(bytes.end(), name.begin(), name.end());
+  bytes.push_back(0);
+  bytes.insert(bytes.end(), type.begin(), type.end());
+  bytes.push_back(0);
+  appendUint32(bytes, value.size());
+  bytes.insert(bytes.end(), value.begin(), value.end());
+}
+
+void writeBytes(std::ofstream& file, const std::vector<unsigned char>& bytes) {
+  file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+}  // namespace
+
+bool writeExr(const std::string& filePath, int width, int height, const float* data,
+              bool flipVertically) {
+  if (width <= 0 || height <= 0) return false;
+  std::ofstream file(filePath, std::ios::binary);
+  if (!file) return false;
+
+  // Magic number and version 2 of a single part scanline file
+  std::vector<unsigned char> header = {0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0};
+
+  std::vector<unsigned char> channels = {'Y', 0};
+  appendUint32(channels, exrPixelTypeFloat);
+  channels.insert(channels.end(), {0, 0, 0, 0});  // linear flag and reserved bytes
+  appendUint32(channels, 1);                      // x and y sampling
+  appendUint32(channels, 1);
+  channels.push_back(0);
+  appendAttribute(header, "channels", "chlist", channels);
+  appendAttribute(header, "compression", "compression", {0});
+
+  std::vector<unsigned char> window;
+  for (int value : {0, 0, width - 1, height - 1}) appendUint32(window, value);
+  appendAttribute(header, "dataWindow", "box2i", window);
+  appendAttribute(header, "displayWindow", "box2i", window);
+  appendAttribute(header, "lineOrder", "lineOrder", {0});  // increasing y
+
+  const float one = 1.0f;
+  const float center[2] = {0.0f, 0.0f};
+  std::vector<unsigned char> oneBytes, centerBytes;
+  appendFloats(oneBytes, &one, 1);
+  appendFloats(centerBytes, center, 2);
+  appendAttribute(header, "pixelAspectRatio", "float", oneBytes);
+  appendAttribute(header, "screenWindowCenter", "v2f", centerBytes);
+  appendAttribute(header, "screenWindowWidth", "float", oneBytes);
+  header.push_back(0);
+
+  // Every scanline is its own block of y, size and data, the offset table points at them
+  const size_t lineBytes = 8 + (size_t)width * sizeof(float);
+  const size_t firstLine = header.size() + (size_t)height * 8;
+  for (int y = 0; y < height; y++) appendUint64(header, firstLine + y * lineBytes);
+  writeBytes(file, header);
+
+  std::vector<unsigned char> line;
+  line.reserve(lineBytes);
+  for (int y = 0; y < height; y++) {
+    line.clear();
+    appendUint32(line, y);
+    appendUint32(line, width * sizeof(float));
+    const size_t sourceRow = flipVertically ? height - 1 - y : y;
+    appendFloats(line, data + sourceRow * width, width);
+    writeBytes(file, line);
+  }
+  return bool(file);
+}
+
+bool writeRawFloats(const std::string& filePath, int width, int height, const float* data,
+                    bool flipVertically) {
+  if (width <= 0 || height <= 0) return false;
+  std::ofstream file(filePath, std::ios::binary);
+  if (!file) return false;
+
+  std::vector<unsigned char> line;
+  line.reserve((size_t)width * sizeof(float));
+  for (int y = 0; y < height; y++) {
+    line.clear();
+    const size_t sourceRow = flipVertically ? height - 1 - y : y;
+    appendFloats(line, data + sourceRow * width, width);
+    writeBytes(file, line);
+  }
+  return bool(file);
+}
+}  // namespace utils
+}  // namespace procrock
@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+
+namespace procrock {
+namespace utils {
+// Single channel images with 32 bit floats, for data like displacement that loses too much
+// precision in bytes. The rows are written as they are encoded, without a copy of the image.
+// Return false if the file could not be written.
+
+// Uncompressed scanline OpenEXR file with the values in the luminance channel Y
+bool writeExr(const std::string& filePath, int width, int height, const float* data,
+              bool flipVertically = false);
+
+// Headerless little endian floats, row by row from the top
+bool writeRawFloats(const std::string& filePath, int width, int height, const float* data,
+                    bool flipVertically = false);
+}  // namespace utils
+}  // namespace procrock
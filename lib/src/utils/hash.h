@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+
+#include "configurable.h"
+#include "serialization.h"
+
+namespace procrock {
+namespace utils {
+// Serialized form as in a saved pipeline, so everything that ends up in the file is covered
+inline std::string serializeConfiguration(const Configuration& config) {
+  nlohmann::json json = config;
+  return json.dump();
+}
+
+// Same as above for the groups added under one name, e.g. by a ConfigurableExtender
+inline std::string serializeConfigurationGroups(const Configuration& config,
+                                                const std::string& name) {
+  for (const auto& group : config.getConfigGroupsConst()) {
+    if (group.first != name) continue;
+    nlohmann::json json = group.second;
+    return json.dump();
+  }
+  return "";
+}
+
+// Serialized form of all groups except the ones added under one name
+inline std::string serializeConfigurationWithout(const Configuration& config,
+                                                 const std::string& name) {
+  std::string result;
+  for (const auto& group : config.getConfigGroupsConst()) {
+    if (group.first == name) continue;
+    nlohmann::json json = group.second;
+    result += json.dump();
+  }
+  return result;
+}
+}  // namespace utils
+}  // namespace procrock
@@ -0,0 +1,51 @@
+#include "utils/instruction_set.h"
+
+#if defined(PROCROCK_SIMD) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace procrock {
+namespace utils {
+namespace {
+InstructionSet detectInstructionSet() {
+#ifdef PROCROCK_SIMD
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) return InstructionSet::Scalar;
+
+  __cpuid(info, 1);
+  bool sse41 = (info[2] & (1 << 19)) != 0;
+  bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+                    (_xgetbv(0) & 0x6) == 0x6;
+  __cpuidex(info, 7, 0);
+  bool avx2 = osSavesAvx && (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  bool sse41 = __builtin_cpu_supports("sse4.1");
+  bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+  if (avx2) return InstructionSet::Avx2;
+  if (sse41) return InstructionSet::Sse41;
+#endif
+  return InstructionSet::Scalar;
+}
+}  // namespace
+
+InstructionSet getInstructionSet() {
+  static const InstructionSet instructionSet = detectInstructionSet();
+  return instructionSet;
+}
+
+const char* getInstructionSetName(InstructionSet instructionSet) {
+  switch (instructionSet) {
+    case InstructionSet::Avx2:
+      return "AVX2";
+    case InstructionSet::Sse41:
+      return "SSE4.1";
+    default:
+      return "Scalar";
+  }
+}
+}  // namespace utils
+}  // namespace procrock
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace procrock {
+namespace utils {
+// Vector instruction sets the kernels have versions for. The SSE4.1 and AVX2 versions are only
+// compiled in when PROCROCK_SIMD is defined.
+enum class InstructionSet { Scalar, Sse41, Avx2 };
+
+// Best instruction set of this cpu the kernels can use, detected once
+InstructionSet getInstructionSet();
+const char* getInstructionSetName(InstructionSet instructionSet);
+}  // namespace utils
+}  // namespace procrock
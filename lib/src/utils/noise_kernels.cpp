@@ -0,0 +1,270 @@
+#include "utils/noise_kernels.h"
+
+#include "utils/instruction_set.h"
+
+#include <noise/noise.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace procrock {
+namespace utils {
+namespace {
+void perlinNoiseScalar(const CoherentNoiseParams& params, const double* x, const double* y,
+                       const double* z, double* out, int count) {
+  for (int i = 0; i < count; i++) {
+    double value = 0.0;
+    double curPersistence = 1.0;
+    double px = x[i] * params.frequency;
+    double py = y[i] * params.frequency;
+    double pz = z[i] * params.frequency;
+
+    for (int octave = 0; octave < params.octaveCount; octave++) {
+      int seed = (params.seed + octave) & 0xffffffff;
+      double signal = noise::GradientCoherentNoise3D(
+          noise::MakeInt32Range(px), noise::MakeInt32Range(py), noise::MakeInt32Range(pz), seed,
+          noise::QUALITY_STD);
+      value += signal * curPersistence;
+
+      px *= params.lacunarity;
+      py *= params.lacunarity;
+      pz *= params.lacunarity;
+      curPersistence *= params.persistence;
+    }
+    out[i] = value;
+  }
+}
+
+void billowNoiseScalar(const CoherentNoiseParams& params, const double* x, const double* y,
+                       const double* z, double* out, int count) {
+  for (int i = 0; i < count; i++) {
+    double value = 0.0;
+    double curPersistence = 1.0;
+    double px = x[i] * params.frequency;
+    double py = y[i] * params.frequency;
+    double pz = z[i] * params.frequency;
+
+    for (int octave = 0; octave < params.octaveCount; octave++) {
+      int seed = (params.seed + octave) & 0xffffffff;
+      double signal = noise::GradientCoherentNoise3D(
+          noise::MakeInt32Range(px), noise::MakeInt32Range(py), noise::MakeInt32Range(pz), seed,
+          noise::QUALITY_STD);
+      signal = 2.0 * std::fabs(signal) - 1.0;
+      value += signal * curPersistence;
+
+      px *= params.lacunarity;
+      py *= params.lacunarity;
+      pz *= params.lacunarity;
+      curPersistence *= params.persistence;
+    }
+    out[i] = value + 0.5;
+  }
+}
+
+void ridgedMultiNoiseScalar(const CoherentNoiseParams& params, const double* x,
+                            const double* y, const double* z, double* out, int count) {
+  const int maxOctaves = 30;  // RIDGED_MAX_OCTAVE
+  double spectralWeights[maxOctaves];
+  double frequency = 1.0;
+  for (int i = 0; i < maxOctaves; i++) {
+    spectralWeights[i] = std::pow(frequency, -1.0);
+    frequency *= params.lacunarity;
+  }
+
+  for (int i = 0; i < count; i++) {
+    double value = 0.0;
+    double weight = 1.0;
+    double px = x[i] * params.frequency;
+    double py = y[i] * params.frequency;
+    double pz = z[i] * params.frequency;
+
+    for (int octave = 0; octave < params.octaveCount; octave++) {
+      int seed = (params.seed + octave) & 0x7fffffff;
+      double signal = noise::GradientCoherentNoise3D(
+          noise::MakeInt32Range(px), noise::MakeInt32Range(py), noise::MakeInt32Range(pz), seed,
+          noise::QUALITY_STD);
+
+      // Make the ridges and weight successive octaves by the previous signal
+      signal = 1.0 - std::fabs(signal);
+      signal *= signal;
+      signal *= weight;
+      weight = std::min(1.0, std::max(0.0, signal * 2.0));
+
+      value += signal * spectralWeights[octave];
+
+      px *= params.lacunarity;
+      py *= params.lacunarity;
+      pz *= params.lacunarity;
+    }
+    out[i] = (value * 1.25) - 1.0;
+  }
+}
+
+void voronoiNoiseScalar(const VoronoiParams& params, const double* x, const double* y,
+                        const double* z, double* out, int count) {
+  for (int i = 0; i < count; i++) {
+    double px = x[i] * params.frequency;
+    double py = y[i] * params.frequency;
+    double pz = z[i] * params.frequency;
+
+    int xInt = (px > 0.0 ? (int)px : (int)px - 1);
+    int yInt = (py > 0.0 ? (int)py : (int)py - 1);
+    int zInt = (pz > 0.0 ? (int)pz : (int)pz - 1);
+
+    // Find the closest seed point in the surrounding cubes
+    double minDist = 2147483647.0;
+    double xCandidate = 0, yCandidate = 0, zCandidate = 0;
+    for (int zCur = zInt - 2; zCur <= zInt + 2; zCur++) {
+      for (int yCur = yInt - 2; yCur <= yInt + 2; yCur++) {
+        for (int xCur = xInt - 2; xCur <= xInt + 2; xCur++) {
+          double xPos = xCur + noise::ValueNoise3D(xCur, yCur, zCur, params.seed);
+          double yPos = yCur + noise::ValueNoise3D(xCur, yCur, zCur, params.seed + 1);
+          double zPos = zCur + noise::ValueNoise3D(xCur, yCur, zCur, params.seed + 2);
+          double xDist = xPos - px;
+          double yDist = yPos - py;
+          double zDist = zPos - pz;
+          double dist = xDist * xDist + yDist * yDist + zDist * zDist;
+
+          if (dist < minDist) {
+            minDist = dist;
+            xCandidate = xPos;
+            yCandidate = yPos;
+            zCandidate = zPos;
+          }
+        }
+      }
+    }
+
+    double value = 0.0;
+    if (params.enableDistance) {
+      double xDist = xCandidate - px;
+      double yDist = yCandidate - py;
+      double zDist = zCandidate - pz;
+      value = std::sqrt(xDist * xDist + yDist * yDist + zDist * zDist) * 1.7320508075688772935 -
+              1.0;
+    }
+
+    out[i] = value + params.displacement * noise::ValueNoise3D((int)std::floor(xCandidate),
+                                                               (int)std::floor(yCandidate),
+                                                               (int)std::floor(zCandidate));
+  }
+}
+
+#ifdef PROCROCK_SIMD
+// libnoise does not expose its gradient vector table, so it is read back through
+// GradientNoise3D. Probing with an offset of t along one axis yields (gradient * t) * 2.12, the
+// exact table value is the one that reproduces all probes bit for bit.
+std::array<double, 256 * 4> recoverGradients() {
+  std::array<double, 256 * 4> gradients;
+  gradients.fill(0.0);
+  std::array<bool, 256> found;
+  found.fill(false);
+
+  const double probes[] = {1.0, 0.1, 0.3, 0.7, 0.9};
+  int foundCount = 0;
+  for (int ix = 0; foundCount < 256; ix++) {
+    int index = 1619 * ix;
+    index ^= (index >> 8);
+    index &= 0xff;
+    if (found[index]) continue;
+    found[index] = true;
+    foundCount++;
+
+    for (int axis = 0; axis < 3; axis++) {
+      auto probe = [&](double t) {
+        double offset[3] = {0.0, 0.0, 0.0};
+        offset[axis] = t;
+        return noise::GradientNoise3D(ix + offset[0], offset[1], offset[2], ix, 0, 0, 0);
+      };
+      auto matches = [&](double gradient) {
+        for (double t : probes) {
+          double point = axis == 0 ? ((double)ix + t) - (double)ix : t;
+          if ((gradient * point) * 2.12 != probe(t)) return false;
+        }
+        return true;
+      };
+
+      double estimate = probe(1.0) / 2.12;
+      double gradient = estimate;
+      double below = estimate, above = estimate;
+      for (int step = 0; step < 8; step++) {
+        if (matches(below)) {
+          gradient = below;
+          break;
+        }
+        if (matches(above)) {
+          gradient = above;
+          break;
+        }
+        below = std::nextafter(below, -1.0);
+        above = std::nextafter(above, 1.0);
+      }
+      gradients[index * 4 + axis] = gradient;
+    }
+  }
+  return gradients;
+}
+
+const double* getGradients() {
+  static const std::array<double, 256 * 4> gradients = recoverGradients();
+  return gradients.data();
+}
+#endif
+}  // namespace
+
+const char* getNoiseKernelInstructionSet() { return getInstructionSetName(getInstructionSet()); }
+
+void perlinNoise(const CoherentNoiseParams& params, const double* x, const double* y,
+                 const double* z, double* out, int count) {
+  int done = 0;
+#ifdef PROCROCK_SIMD
+  if (getInstructionSet() == InstructionSet::Avx2) {
+    done = avx2::perlinNoise(params, getGradients(), x, y, z, out, count);
+  } else if (getInstructionSet() == InstructionSet::Sse41) {
+    done = sse41::perlinNoise(params, getGradients(), x, y, z, out, count);
+  }
+#endif
+  perlinNoiseScalar(params, x + done, y + done, z + done, out + done, count - done);
+}
+
+void billowNoise(const CoherentNoiseParams& params, const double* x, const double* y,
+                 const double* z, double* out, int count) {
+  int done = 0;
+#ifdef PROCROCK_SIMD
+  if (getInstructionSet() == InstructionSet::Avx2) {
+    done = avx2::billowNoise(params, getGradients(), x, y, z, out, count);
+  } else if (getInstructionSet() == InstructionSet::Sse41) {
+    done = sse41::billowNoise(params, getGradients(), x, y, z, out, count);
+  }
+#endif
+  billowNoiseScalar(params, x + done, y + done, z + done, out + done, count - done);
+}
+
+void ridgedMultiNoise(const CoherentNoiseParams& params, const double* x, const double* y,
+                      const double* z, double* out, int count) {
+  int done = 0;
+#ifdef PROCROCK_SIMD
+  if (getInstructionSet() == InstructionSet::Avx2) {
+    done = avx2::ridgedMultiNoise(params, getGradients(), x, y, z, out, count);
+  } else if (getInstructionSet() == InstructionSet::Sse41) {
+    done = sse41::ridgedMultiNoise(params, getGradients(), x, y, z, out, count);
+  }
+#endif
+  ridgedMultiNoiseScalar(params, x + done, y + done, z + done, out + done, count - done);
+}
+
+void voronoiNoise(const VoronoiParams& params, const double* x, const double* y, const double* z,
+                  double* out, int count) {
+  int done = 0;
+#ifdef PROCROCK_SIMD
+  if (getInstructionSet() == InstructionSet::Avx2) {
+    done = avx2::voronoiNoise(params, x, y, z, out, count);
+  } else if (getInstructionSet() == InstructionSet::Sse41) {
+    done = sse41::voronoiNoise(params, x, y, z, out, count);
+  }
+#endif
+  voronoiNoiseScalar(params, x + done, y + done, z + done, out + done, count - done);
+}
+}  // namespace utils
+}  // namespace procrock
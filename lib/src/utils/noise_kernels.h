@@ -0,0 +1,63 @@
+#pragma once
+
+namespace procrock {
+namespace utils {
+// Batch versions of the libnoise generator modules, they compute the same values as the
+// corresponding GetValue for every position.
+// The noise nodes never set a noise quality, so everything uses libnoise's QUALITY_STD.
+// Depending on the cpu, they run vectorized with AVX2 or SSE4.1 and fall back to scalar code.
+
+struct CoherentNoiseParams {
+  double frequency = 1.0;
+  double lacunarity = 2.0;
+  double persistence = 0.5;  // not used by ridged multifractal noise
+  int octaveCount = 6;
+  int seed = 0;
+};
+
+struct VoronoiParams {
+  double frequency = 1.0;
+  double displacement = 1.0;
+  bool enableDistance = false;
+  int seed = 0;
+};
+
+void perlinNoise(const CoherentNoiseParams& params, const double* x, const double* y,
+                 const double* z, double* out, int count);
+void billowNoise(const CoherentNoiseParams& params, const double* x, const double* y,
+                 const double* z, double* out, int count);
+void ridgedMultiNoise(const CoherentNoiseParams& params, const double* x, const double* y,
+                      const double* z, double* out, int count);
+void voronoiNoise(const VoronoiParams& params, const double* x, const double* y, const double* z,
+                  double* out, int count);
+
+// Name of the instruction set the kernels use on this cpu
+const char* getNoiseKernelInstructionSet();
+
+#ifdef PROCROCK_SIMD
+// Vectorized kernels, they process as many positions as fit into full vectors and return how
+// many that were. The gradients are libnoise's gradient vectors, four doubles per entry.
+namespace avx2 {
+int perlinNoise(const CoherentNoiseParams& params, const double* gradients, const double* x,
+                const double* y, const double* z, double* out, int count);
+int billowNoise(const CoherentNoiseParams& params, const double* gradients, const double* x,
+                const double* y, const double* z, double* out, int count);
+int ridgedMultiNoise(const CoherentNoiseParams& params, const double* gradients, const double* x,
+                     const double* y, const double* z, double* out, int count);
+int voronoiNoise(const VoronoiParams& params, const double* x, const double* y, const double* z,
+                 double* out, int count);
+}  // namespace avx2
+
+namespace sse41 {
+int perlinNoise(const CoherentNoiseParams& params, const double* gradients, const double* x,
+                const double* y, const double* z, double* out, int count);
+int billowNoise(const CoherentNoiseParams& params, const double* gradients, const double* x,
+                const double* y, const double* z, double* out, int count);
+int ridgedMultiNoise(const CoherentNoiseParams& params, const double* gradients, const double* x,
+                     const double* y, const double* z, double* out, int count);
+int voronoiNoise(const VoronoiParams& params, const double* x, const double* y, const double* z,
+                 double* out, int count);
+}  // namespace sse41
+#endif
+}  // namespace utils
+}  // namespace procrock
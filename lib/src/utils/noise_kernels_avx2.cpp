@@ -0,0 +1,79 @@
+// Compiled with AVX2 enabled, only called after checking the cpu supports it
+#ifdef PROCROCK_SIMD
+#include <immintrin.h>
+
+#include "utils/noise_kernels_simd.h"
+
+namespace procrock {
+namespace utils {
+namespace {
+struct Avx2Operations {
+  typedef __m256d Double;
+  typedef __m128i Int;
+  static const int width = 4;
+
+  static inline Double load(const double* values) { return _mm256_loadu_pd(values); }
+  static inline void store(double* values, Double a) { _mm256_storeu_pd(values, a); }
+  static inline Double set1(double value) { return _mm256_set1_pd(value); }
+
+  static inline Double add(Double a, Double b) { return _mm256_add_pd(a, b); }
+  static inline Double sub(Double a, Double b) { return _mm256_sub_pd(a, b); }
+  static inline Double mul(Double a, Double b) { return _mm256_mul_pd(a, b); }
+  static inline Double min(Double a, Double b) { return _mm256_min_pd(a, b); }
+  static inline Double max(Double a, Double b) { return _mm256_max_pd(a, b); }
+  static inline Double sqrt(Double a) { return _mm256_sqrt_pd(a); }
+  static inline Double floor(Double a) { return _mm256_floor_pd(a); }
+  static inline Double abs(Double a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+
+  static inline Double cmpLt(Double a, Double b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static inline Double cmpGt(Double a, Double b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+  static inline Double cmpGe(Double a, Double b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+  static inline bool any(Double mask) { return _mm256_movemask_pd(mask) != 0; }
+  // Takes b where the mask is set
+  static inline Double blend(Double a, Double b, Double mask) {
+    return _mm256_blendv_pd(a, b, mask);
+  }
+
+  static inline Int truncate(Double a) { return _mm256_cvttpd_epi32(a); }
+  static inline Double toDouble(Int a) { return _mm256_cvtepi32_pd(a); }
+  static inline Double gather(const double* base, Int index) {
+    return _mm256_i32gather_pd(base, index, 8);
+  }
+
+  static inline Int set1Int(int value) { return _mm_set1_epi32(value); }
+  static inline Int addInt(Int a, Int b) { return _mm_add_epi32(a, b); }
+  static inline Int mulInt(Int a, Int b) { return _mm_mullo_epi32(a, b); }
+  static inline Int xorInt(Int a, Int b) { return _mm_xor_si128(a, b); }
+  static inline Int andInt(Int a, Int b) { return _mm_and_si128(a, b); }
+  static inline Int shiftRightInt(Int a, int bits) { return _mm_srai_epi32(a, bits); }
+  static inline Int shiftLeftInt(Int a, int bits) { return _mm_slli_epi32(a, bits); }
+};
+}  // namespace
+
+namespace avx2 {
+int perlinNoise(const CoherentNoiseParams& params, const double* gradients, const double* x,
+                const double* y, const double* z, double* out, int count) {
+  return simd::coherentNoise<Avx2Operations, simd::CoherentNoiseType::Perlin>(
+      params, gradients, x, y, z, out, count);
+}
+
+int billowNoise(const CoherentNoiseParams& params, const double* gradients, const double* x,
+                const double* y, const double* z, double* out, int count) {
+  return simd::coherentNoise<Avx2Operations, simd::CoherentNoiseType::Billow>(
+      params, gradients, x, y, z, out, count);
+}
+
+int ridgedMultiNoise(const CoherentNoiseParams& params, const double* gradients, const double* x,
+                     const double* y, const double* z, double* out, int count) {
+  return simd::coherentNoise<Avx2Operations, simd::CoherentNoiseType::Ridged>(
+      params, gradients, x, y, z, out, count);
+}
+
+int voronoiNoise(const VoronoiParams& params, const double* x, const double* y, const double* z,
+                 double* out, int count) {
+  return simd::voronoiNoise<Avx2Operations>(params, x, y, z, out, count);
+}
+}  // namespace avx2
+}  // namespace utils
+}  // namespace procrock
+#endif
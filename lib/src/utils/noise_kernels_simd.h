@@ -0,0 +1,277 @@
+#pragma once
+// Vectorized versions of the noise kernels, written once against a set of vector operations.
+// Only include this from the translation units compiled for the matching instruction set.
+// The operations are declared there in an anonymous namespace, so every instantiation stays
+// local to its translation unit.
+#include <math.h>
+
+#include "utils/noise_kernels.h"
+
+namespace procrock {
+namespace utils {
+namespace simd {
+
+// Seed contribution to the lattice hash, wraps around like the int math in libnoise
+static inline int seedTerm(int seed) { return (int)(1013u * (unsigned int)seed); }
+
+template <typename V>
+inline typename V::Double makeInt32Range(typename V::Double n) {
+  if (!V::any(V::cmpGe(V::abs(n), V::set1(1073741824.0)))) return n;
+
+  double values[V::width];
+  V::store(values, n);
+  for (int i = 0; i < V::width; i++) {
+    if (values[i] >= 1073741824.0) {
+      values[i] = (2.0 * fmod(values[i], 1073741824.0)) - 1073741824.0;
+    } else if (values[i] <= -1073741824.0) {
+      values[i] = (2.0 * fmod(values[i], 1073741824.0)) + 1073741824.0;
+    }
+  }
+  return V::load(values);
+}
+
+// Same as libnoise's (x > 0.0 ? (int)x : (int)x - 1), which is not quite floor for integers
+template <typename V>
+inline typename V::Int latticeCoord(typename V::Double p, typename V::Double& latticeDouble) {
+  typename V::Double truncated = V::toDouble(V::truncate(p));
+  latticeDouble = V::blend(V::sub(truncated, V::set1(1.0)), truncated,
+                           V::cmpGt(p, V::set1(0.0)));
+  return V::truncate(latticeDouble);
+}
+
+template <typename V>
+inline typename V::Int latticeHash(typename V::Int x, typename V::Int y, typename V::Int z,
+                                   int seedTerm) {
+  return V::addInt(V::addInt(V::mulInt(x, V::set1Int(1619)), V::mulInt(y, V::set1Int(31337))),
+                   V::addInt(V::mulInt(z, V::set1Int(6971)), V::set1Int(seedTerm)));
+}
+
+template <typename V>
+inline typename V::Double sCurve3(typename V::Double a) {
+  return V::mul(V::mul(a, a), V::sub(V::set1(3.0), V::mul(V::set1(2.0), a)));
+}
+
+template <typename V>
+inline typename V::Double linearInterp(typename V::Double n0, typename V::Double n1,
+                                       typename V::Double a) {
+  return V::add(V::mul(V::sub(V::set1(1.0), a), n0), V::mul(a, n1));
+}
+
+template <typename V>
+inline typename V::Double gradientNoise(typename V::Double fx, typename V::Double fy,
+                                        typename V::Double fz, typename V::Int ix,
+                                        typename V::Int iy, typename V::Int iz,
+                                        typename V::Double ixDouble, typename V::Double iyDouble,
+                                        typename V::Double izDouble, int seedTerm,
+                                        const double* gradients) {
+  typename V::Int index = latticeHash<V>(ix, iy, iz, seedTerm);
+  index = V::xorInt(index, V::shiftRightInt(index, 8));
+  index = V::andInt(index, V::set1Int(0xff));
+  index = V::shiftLeftInt(index, 2);
+
+  typename V::Double xGradient = V::gather(gradients, index);
+  typename V::Double yGradient = V::gather(gradients + 1, index);
+  typename V::Double zGradient = V::gather(gradients + 2, index);
+
+  typename V::Double xPoint = V::sub(fx, ixDouble);
+  typename V::Double yPoint = V::sub(fy, iyDouble);
+  typename V::Double zPoint = V::sub(fz, izDouble);
+
+  return V::mul(V::add(V::add(V::mul(xGradient, xPoint), V::mul(yGradient, yPoint)),
+                       V::mul(zGradient, zPoint)),
+                V::set1(2.12));
+}
+
+// GradientCoherentNoise3D with QUALITY_STD
+template <typename V>
+inline typename V::Double gradientCoherentNoise(typename V::Double x, typename V::Double y,
+                                                typename V::Double z, int seedTerm,
+                                                const double* gradients) {
+  typedef typename V::Double Double;
+  typedef typename V::Int Int;
+
+  Double x0Double, y0Double, z0Double;
+  Int x0 = latticeCoord<V>(x, x0Double);
+  Int y0 = latticeCoord<V>(y, y0Double);
+  Int z0 = latticeCoord<V>(z, z0Double);
+  Int x1 = V::addInt(x0, V::set1Int(1));
+  Int y1 = V::addInt(y0, V::set1Int(1));
+  Int z1 = V::addInt(z0, V::set1Int(1));
+  Double x1Double = V::add(x0Double, V::set1(1.0));
+  Double y1Double = V::add(y0Double, V::set1(1.0));
+  Double z1Double = V::add(z0Double, V::set1(1.0));
+
+  Double xs = sCurve3<V>(V::sub(x, x0Double));
+  Double ys = sCurve3<V>(V::sub(y, y0Double));
+  Double zs = sCurve3<V>(V::sub(z, z0Double));
+
+  auto noise = [&](Int ix, Int iy, Int iz, Double ixDouble, Double iyDouble, Double izDouble) {
+    return gradientNoise<V>(x, y, z, ix, iy, iz, ixDouble, iyDouble, izDouble, seedTerm,
+                            gradients);
+  };
+
+  Double ix0 = linearInterp<V>(noise(x0, y0, z0, x0Double, y0Double, z0Double),
+                               noise(x1, y0, z0, x1Double, y0Double, z0Double), xs);
+  Double ix1 = linearInterp<V>(noise(x0, y1, z0, x0Double, y1Double, z0Double),
+                               noise(x1, y1, z0, x1Double, y1Double, z0Double), xs);
+  Double iy0 = linearInterp<V>(ix0, ix1, ys);
+  ix0 = linearInterp<V>(noise(x0, y0, z1, x0Double, y0Double, z1Double),
+                        noise(x1, y0, z1, x1Double, y0Double, z1Double), xs);
+  ix1 = linearInterp<V>(noise(x0, y1, z1, x0Double, y1Double, z1Double),
+                        noise(x1, y1, z1, x1Double, y1Double, z1Double), xs);
+  Double iy1 = linearInterp<V>(ix0, ix1, ys);
+  return linearInterp<V>(iy0, iy1, zs);
+}
+
+// ValueNoise3D, the integer hash is the same as libnoise's IntValueNoise3D
+template <typename V>
+inline typename V::Double valueNoise(typename V::Int x, typename V::Int y, typename V::Int z,
+                                     int seedTerm) {
+  typename V::Int n = V::andInt(latticeHash<V>(x, y, z, seedTerm), V::set1Int(0x7fffffff));
+  n = V::xorInt(V::shiftRightInt(n, 13), n);
+  typename V::Int factor =
+      V::addInt(V::mulInt(V::mulInt(n, n), V::set1Int(60493)), V::set1Int(19990303));
+  n = V::andInt(V::addInt(V::mulInt(n, factor), V::set1Int(1376312589)),
+                V::set1Int(0x7fffffff));
+  return V::sub(V::set1(1.0), V::mul(V::toDouble(n), V::set1(1.0 / 1073741824.0)));
+}
+
+enum class CoherentNoiseType { Perlin, Billow, Ridged };
+
+// Processes all complete vectors and returns how many positions that were
+template <typename V, CoherentNoiseType type>
+int coherentNoise(const CoherentNoiseParams& params, const double* gradients, const double* x,
+                  const double* y, const double* z, double* out, int count) {
+  typedef typename V::Double Double;
+
+  const int maxOctaves = 30;  // RIDGED_MAX_OCTAVE
+  double spectralWeights[maxOctaves];
+  if (type == CoherentNoiseType::Ridged) {
+    double frequency = 1.0;
+    for (int i = 0; i < maxOctaves; i++) {
+      spectralWeights[i] = pow(frequency, -1.0);
+      frequency *= params.lacunarity;
+    }
+  }
+
+  const int vectorCount = count - count % V::width;
+  const Double frequency = V::set1(params.frequency);
+  const Double lacunarity = V::set1(params.lacunarity);
+
+  for (int i = 0; i < vectorCount; i += V::width) {
+    Double px = V::mul(V::load(x + i), frequency);
+    Double py = V::mul(V::load(y + i), frequency);
+    Double pz = V::mul(V::load(z + i), frequency);
+
+    Double value = V::set1(0.0);
+    Double weight = V::set1(1.0);
+    double curPersistence = 1.0;
+
+    for (int octave = 0; octave < params.octaveCount; octave++) {
+      int seed = (params.seed + octave) & 0xffffffff;
+      if (type == CoherentNoiseType::Ridged) seed = (params.seed + octave) & 0x7fffffff;
+
+      Double signal =
+          gradientCoherentNoise<V>(makeInt32Range<V>(px), makeInt32Range<V>(py),
+                                   makeInt32Range<V>(pz), seedTerm(seed), gradients);
+
+      if (type == CoherentNoiseType::Perlin) {
+        value = V::add(value, V::mul(signal, V::set1(curPersistence)));
+      } else if (type == CoherentNoiseType::Billow) {
+        signal = V::sub(V::mul(V::set1(2.0), V::abs(signal)), V::set1(1.0));
+        value = V::add(value, V::mul(signal, V::set1(curPersistence)));
+      } else {
+        signal = V::sub(V::set1(1.0), V::abs(signal));
+        signal = V::mul(signal, signal);
+        signal = V::mul(signal, weight);
+        weight = V::max(V::min(V::mul(signal, V::set1(2.0)), V::set1(1.0)), V::set1(0.0));
+        value = V::add(value, V::mul(signal, V::set1(spectralWeights[octave])));
+      }
+
+      px = V::mul(px, lacunarity);
+      py = V::mul(py, lacunarity);
+      pz = V::mul(pz, lacunarity);
+      curPersistence *= params.persistence;
+    }
+
+    if (type == CoherentNoiseType::Billow) {
+      value = V::add(value, V::set1(0.5));
+    } else if (type == CoherentNoiseType::Ridged) {
+      value = V::sub(V::mul(value, V::set1(1.25)), V::set1(1.0));
+    }
+    V::store(out + i, value);
+  }
+  return vectorCount;
+}
+
+template <typename V>
+int voronoiNoise(const VoronoiParams& params, const double* x, const double* y, const double* z,
+                 double* out, int count) {
+  typedef typename V::Double Double;
+  typedef typename V::Int Int;
+
+  const int vectorCount = count - count % V::width;
+  const Double frequency = V::set1(params.frequency);
+
+  for (int i = 0; i < vectorCount; i += V::width) {
+    Double px = V::mul(V::load(x + i), frequency);
+    Double py = V::mul(V::load(y + i), frequency);
+    Double pz = V::mul(V::load(z + i), frequency);
+
+    Double xIntDouble, yIntDouble, zIntDouble;
+    Int xInt = latticeCoord<V>(px, xIntDouble);
+    Int yInt = latticeCoord<V>(py, yIntDouble);
+    Int zInt = latticeCoord<V>(pz, zIntDouble);
+
+    // Find the closest seed point in the surrounding cubes
+    Double minDist = V::set1(2147483647.0);
+    Double xCandidate = V::set1(0.0), yCandidate = V::set1(0.0), zCandidate = V::set1(0.0);
+    for (int zOffset = -2; zOffset <= 2; zOffset++) {
+      Int zCur = V::addInt(zInt, V::set1Int(zOffset));
+      for (int yOffset = -2; yOffset <= 2; yOffset++) {
+        Int yCur = V::addInt(yInt, V::set1Int(yOffset));
+        for (int xOffset = -2; xOffset <= 2; xOffset++) {
+          Int xCur = V::addInt(xInt, V::set1Int(xOffset));
+
+          Double xPos = V::add(V::toDouble(xCur), valueNoise<V>(xCur, yCur, zCur,
+                                                                seedTerm(params.seed)));
+          Double yPos = V::add(V::toDouble(yCur), valueNoise<V>(xCur, yCur, zCur,
+                                                                seedTerm(params.seed + 1)));
+          Double zPos = V::add(V::toDouble(zCur), valueNoise<V>(xCur, yCur, zCur,
+                                                                seedTerm(params.seed + 2)));
+          Double xDist = V::sub(xPos, px);
+          Double yDist = V::sub(yPos, py);
+          Double zDist = V::sub(zPos, pz);
+          Double dist = V::add(V::add(V::mul(xDist, xDist), V::mul(yDist, yDist)),
+                               V::mul(zDist, zDist));
+
+          Double closer = V::cmpLt(dist, minDist);
+          minDist = V::blend(minDist, dist, closer);
+          xCandidate = V::blend(xCandidate, xPos, closer);
+          yCandidate = V::blend(yCandidate, yPos, closer);
+          zCandidate = V::blend(zCandidate, zPos, closer);
+        }
+      }
+    }
+
+    Double value = V::set1(0.0);
+    if (params.enableDistance) {
+      Double xDist = V::sub(xCandidate, px);
+      Double yDist = V::sub(yCandidate, py);
+      Double zDist = V::sub(zCandidate, pz);
+      Double dist = V::add(V::add(V::mul(xDist, xDist), V::mul(yDist, yDist)),
+                           V::mul(zDist, zDist));
+      value = V::sub(V::mul(V::sqrt(dist), V::set1(1.7320508075688772935)), V::set1(1.0));
+    }
+
+    Double cellValue = valueNoise<V>(V::truncate(V::floor(xCandidate)),
+                                     V::truncate(V::floor(yCandidate)),
+                                     V::truncate(V::floor(zCandidate)), seedTerm(0));
+    V::store(out + i, V::add(value, V::mul(V::set1(params.displacement), cellValue)));
+  }
+  return vectorCount;
+}
+
+}  // namespace simd
+}  // namespace utils
+}  // namespace procrock
@@ -0,0 +1,412 @@
+#include "utils/png_writer.h"
+
+#include <procrocklib/task_pool.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+#include "utils/convert_kernels.h"
+
+namespace procrock {
+namespace utils {
+namespace {
+const unsigned int adlerModulo = 65521;
+const int bandSize = 1 << 18;  // bytes of image data compressed by one task
+const int windowSize = 32768;
+const int maxMatchLength = 258;
+
+// Longest hash chain searched for a match, per compression level
+const int maxChainLengths[10] = {0, 2, 4, 8, 16, 32, 64, 128, 256, 1024};
+
+// Deflate's length and distance codes, as base value and extra bits
+const int lengthBases[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                             31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const int lengthExtraBits[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const int distanceBases[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                               33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                               1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const int distanceExtraBits[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                   6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+unsigned int crc32(unsigned int crc, const unsigned char* data, size_t length) {
+  static const std::array<unsigned int, 256> table = []() {
+    std::array<unsigned int, 256> table;
+    for (unsigned int i = 0; i < 256; i++) {
+      unsigned int value = i;
+      for (int bit = 0; bit < 8; bit++) {
+        value = (value & 1) ? 0xedb88320u ^ (value >> 1) : value >> 1;
+      }
+      table[i] = value;
+    }
+    return table;
+  }();
+
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+struct Adler32 {
+  unsigned int a = 1, b = 0;
+  size_t length = 0;
+
+  void update(const unsigned char* data, size_t size) {
+    length += size;
+    while (size > 0) {
+      // the sums cannot overflow within this many bytes
+      const size_t blockSize = std::min<size_t>(size, 5552);
+      for (size_t i = 0; i < blockSize; i++) {
+        a += data[i];
+        b += a;
+      }
+      a %= adlerModulo;
+      b %= adlerModulo;
+      data += blockSize;
+      size -= blockSize;
+    }
+  }
+
+  // Continues the checksum with the one of the following data
+  void append(const Adler32& next) {
+    unsigned long long lengthModulo = next.length % adlerModulo;
+    b = (b + next.b + lengthModulo * (a + adlerModulo - 1)) % adlerModulo;
+    a = (a + next.a + adlerModulo - 1) % adlerModulo;
+    length += next.length;
+  }
+};
+
+// Deflate bit stream, bits are filled in from the least significant one
+struct BitWriter {
+  std::vector<unsigned char>& bytes;
+  unsigned int buffer = 0;
+  int count = 0;
+
+  inline void write(unsigned int bits, int bitCount) {
+    buffer |= bits << count;
+    count += bitCount;
+    while (count >= 8) {
+      bytes.push_back(buffer & 0xff);
+      buffer >>= 8;
+      count -= 8;
+    }
+  }
+
+  // Huffman codes are stored starting with their most significant bit
+  inline void writeCode(unsigned int code, int length) {
+    unsigned int reversed = 0;
+    for (int i = 0; i < length; i++) {
+      reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    write(reversed, length);
+  }
+
+  inline void alignToByte() {
+    if (count > 0) write(0, 8 - count);
+  }
+};
+
+// Symbols of the fixed huffman code
+inline void writeSymbol(BitWriter& writer, int symbol) {
+  if (symbol < 144) {
+    writer.writeCode(0x30 + symbol, 8);
+  } else if (symbol < 256) {
+    writer.writeCode(0x190 + symbol - 144, 9);
+  } else if (symbol < 280) {
+    writer.writeCode(symbol - 256, 7);
+  } else {
+    writer.writeCode(0xc0 + symbol - 280, 8);
+  }
+}
+
+inline void writeMatch(BitWriter& writer, int length, int distance) {
+  int lengthCode = std::upper_bound(lengthBases, lengthBases + 29, length) - lengthBases - 1;
+  writeSymbol(writer, 257 + lengthCode);
+  writer.write(length - lengthBases[lengthCode], lengthExtraBits[lengthCode]);
+
+  int distanceCode =
+      std::upper_bound(distanceBases, distanceBases + 30, distance) - distanceBases - 1;
+  writer.writeCode(distanceCode, 5);
+  writer.write(distance - distanceBases[distanceCode], distanceExtraBits[distanceCode]);
+}
+
+inline unsigned int hash(const unsigned char* data) {
+  return ((data[0] << 10) ^ (data[1] << 5) ^ data[2]) & (windowSize - 1);
+}
+
+// Compresses the data into deflate blocks of its own. Unless it is the last one, the blocks end
+// with an empty stored block so the next data starts on a byte boundary.
+void deflate(const unsigned char* data, int size, int compressionLevel, bool last,
+             std::vector<unsigned char>& out) {
+  BitWriter writer{out};
+  const int maxChainLength = maxChainLengths[compressionLevel];
+
+  if (maxChainLength == 0) {
+    for (int offset = 0; offset < size; offset += 65535) {
+      const int blockSize = std::min(65535, size - offset);
+      writer.write(last && offset + blockSize == size ? 1 : 0, 1);
+      writer.write(0, 2);
+      writer.alignToByte();
+      writer.write(blockSize & 0xffff, 16);
+      writer.write(~blockSize & 0xffff, 16);
+      out.insert(out.end(), data + offset, data + offset + blockSize);
+    }
+    return;
+  }
+
+  writer.write(last ? 1 : 0, 1);
+  writer.write(1, 2);  // fixed huffman codes
+
+  std::vector<int> head(windowSize, -1);
+  std::vector<int> previous(size);
+  auto insert = [&](int position) {
+    if (position + 3 > size) return;
+    unsigned int h = hash(data + position);
+    previous[position] = head[h];
+    head[h] = position;
+  };
+
+  int position = 0;
+  while (position < size) {
+    int bestLength = 0, bestDistance = 0;
+    if (position + 3 <= size) {
+      const int maxLength = std::min(maxMatchLength, size - position);
+      int candidate = head[hash(data + position)];
+      for (int chain = 0; chain < maxChainLength && candidate >= 0 &&
+                          position - candidate <= windowSize;
+           chain++) {
+        if (data[candidate + bestLength] == data[position + bestLength]) {
+          int length = 0;
+          while (length < maxLength && data[candidate + length] == data[position + length]) {
+            length++;
+          }
+          if (length > bestLength) {
+            bestLength = length;
+            bestDistance = position - candidate;
+            if (length == maxLength) break;
+          }
+        }
+        candidate = previous[candidate];
+      }
+    }
+
+    if (bestLength >= 3) {
+      writeMatch(writer, bestLength, bestDistance);
+      for (int i = 0; i < bestLength; i++) {
+        insert(position + i);
+      }
+      position += bestLength;
+    } else {
+      writeSymbol(writer, data[position]);
+      insert(position);
+      position++;
+    }
+  }
+  writeSymbol(writer, 256);  // end of block
+
+  if (!last) {
+    writer.write(0, 3);
+    writer.alignToByte();
+    writer.write(0x0000, 16);
+    writer.write(0xffff, 16);
+  }
+  writer.alignToByte();
+}
+
+inline int paeth(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) return a;
+  if (pb <= pc) return b;
+  return c;
+}
+
+// Filters one row with the png filter type that gives the smallest sum of absolute values
+void filterRow(const unsigned char* row, const unsigned char* above, int rowBytes,
+               int pixelBytes, bool tryFilters, unsigned char* out,
+               std::vector<unsigned char>& candidate) {
+  out[0] = 0;
+  std::copy(row, row + rowBytes, out + 1);
+  if (!tryFilters) return;
+
+  long bestSum = 0;
+  for (int i = 0; i < rowBytes; i++) bestSum += std::abs((signed char)row[i]);
+
+  for (int filter = 1; filter < 5; filter++) {
+    long sum = 0;
+    for (int i = 0; i < rowBytes; i++) {
+      const int left = i >= pixelBytes ? row[i - pixelBytes] : 0;
+      const int up = above != nullptr ? above[i] : 0;
+      const int upLeft = i >= pixelBytes && above != nullptr ? above[i - pixelBytes] : 0;
+      int predicted = 0;
+      switch (filter) {
+        case 1:
+          predicted = left;
+          break;
+        case 2:
+          predicted = up;
+          break;
+        case 3:
+          predicted = (left + up) >> 1;
+          break;
+        case 4:
+          predicted = paeth(left, up, upLeft);
+          break;
+      }
+      candidate[i] = (unsigned char)(row[i] - predicted);
+      sum += std::abs((signed char)candidate[i]);
+    }
+    if (sum < bestSum) {
+      bestSum = sum;
+      out[0] = filter;
+      std::copy(candidate.begin(), candidate.end(), out + 1);
+    }
+  }
+}
+
+void appendUint32(std::vector<unsigned char>& bytes, unsigned int value) {
+  bytes.push_back((value >> 24) & 0xff);
+  bytes.push_back((value >> 16) & 0xff);
+  bytes.push_back((value >> 8) & 0xff);
+  bytes.push_back(value & 0xff);
+}
+
+// Length, type, data and checksum of a png chunk
+std::vector<unsigned char> makeChunk(const char* type, const std::vector<unsigned char>& data) {
+  std::vector<unsigned char> chunk;
+  chunk.reserve(data.size() + 12);
+  appendUint32(chunk, data.size());
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+  appendUint32(chunk, crc32(0, chunk.data() + 4, chunk.size() - 4));
+  return chunk;
+}
+
+struct Band {
+  std::vector<unsigned char> chunk;
+  Adler32 checksum;
+};
+
+// Fills in the bytes of image row y, counted from the top as the rows are written
+using RowReader = std::function<void(int y, unsigned char* row)>;
+
+bool writeRows(std::ostream& stream, int width, int height, int channels, int bitDepth,
+               const RowReader& readRow, int compressionLevel) {
+  compressionLevel = std::max(0, std::min(9, compressionLevel));
+  auto writeBytes = [&](const std::vector<unsigned char>& bytes) {
+    stream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  };
+
+  const std::vector<unsigned char> signature = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  writeBytes(signature);
+
+  const unsigned char colorTypes[5] = {0, 0, 4, 2, 6};
+  std::vector<unsigned char> header;
+  appendUint32(header, width);
+  appendUint32(header, height);
+  header.insert(header.end(), {(unsigned char)bitDepth, colorTypes[channels], 0, 0, 0});
+  writeBytes(makeChunk("IHDR", header));
+  writeBytes(makeChunk("IDAT", {0x78, 0x9c}));  // zlib header
+
+  const int pixelBytes = channels * bitDepth / 8;
+  const int rowBytes = width * pixelBytes;
+  const int bandRows = std::max(1, bandSize / rowBytes);
+  const int bandCount = (height + bandRows - 1) / bandRows;
+
+  // Bands are compressed a few at a time and written before the next ones are started
+  const int waveSize = getTaskPool().getThreadCount() * 2;
+  Adler32 checksum;
+  for (int waveBegin = 0; waveBegin < bandCount; waveBegin += waveSize) {
+    const int waveEnd = std::min(bandCount, waveBegin + waveSize);
+    std::vector<Band> bands(waveEnd - waveBegin);
+
+    parallelFor(waveBegin, waveEnd, 1, [&](int begin, int end) {
+      std::vector<unsigned char> candidate(rowBytes);
+      for (int b = begin; b < end; b++) {
+        const int firstRow = b * bandRows;
+        const int lastRow = std::min(height, firstRow + bandRows);
+
+        // The rows of the band and the one above it, which the filters predict from
+        std::vector<unsigned char> rows((size_t)(lastRow - firstRow + 1) * rowBytes);
+        for (int y = std::max(0, firstRow - 1); y < lastRow; y++) {
+          readRow(y, &rows[(size_t)(y - firstRow + 1) * rowBytes]);
+        }
+
+        std::vector<unsigned char> filtered((size_t)(lastRow - firstRow) * (rowBytes + 1));
+        for (int y = firstRow; y < lastRow; y++) {
+          const unsigned char* row = &rows[(size_t)(y - firstRow + 1) * rowBytes];
+          filterRow(row, y > 0 ? row - rowBytes : nullptr, rowBytes, pixelBytes,
+                    compressionLevel > 0, &filtered[(size_t)(y - firstRow) * (rowBytes + 1)],
+                    candidate);
+        }
+
+        auto& band = bands[b - waveBegin];
+        band.checksum.update(filtered.data(), filtered.size());
+        std::vector<unsigned char> compressed;
+        deflate(filtered.data(), filtered.size(), compressionLevel, b == bandCount - 1,
+                compressed);
+        band.chunk = makeChunk("IDAT", compressed);
+      }
+    });
+
+    for (const auto& band : bands) {
+      writeBytes(band.chunk);
+      checksum.append(band.checksum);
+    }
+  }
+
+  std::vector<unsigned char> trailer;
+  appendUint32(trailer, (checksum.b << 16) | checksum.a);
+  writeBytes(makeChunk("IDAT", trailer));
+  writeBytes(makeChunk("IEND", {}));
+  return bool(stream);
+}
+}  // namespace
+
+bool writePng(const std::string& filePath, int width, int height, int channels,
+              const unsigned char* data, int compressionLevel, bool flipVertically) {
+  std::ofstream file(filePath, std::ios::binary);
+  if (!file) return false;
+  return writePng(file, width, height, channels, data, compressionLevel, flipVertically);
+}
+
+bool writePng(std::ostream& stream, int width, int height, int channels,
+              const unsigned char* data, int compressionLevel, bool flipVertically) {
+  if (width <= 0 || height <= 0 || channels < 1 || channels > 4) return false;
+  const int rowBytes = width * channels;
+  return writeRows(
+      stream, width, height, channels, 8,
+      [&](int y, unsigned char* row) {
+        const size_t sourceRow = flipVertically ? height - 1 - y : y;
+        const unsigned char* source = data + sourceRow * rowBytes;
+        std::copy(source, source + rowBytes, row);
+      },
+      compressionLevel);
+}
+
+bool writeGreyPng(const std::string& filePath, int width, int height, const float* data,
+                  int bitDepth, int compressionLevel, bool flipVertically) {
+  if (width <= 0 || height <= 0 || (bitDepth != 8 && bitDepth != 16)) return false;
+  std::ofstream file(filePath, std::ios::binary);
+  if (!file) return false;
+  return writeRows(
+      file, width, height, 1, bitDepth,
+      [&](int y, unsigned char* row) {
+        const size_t sourceRow = flipVertically ? height - 1 - y : y;
+        const float* source = data + sourceRow * width;
+        if (bitDepth == 16) {
+          floatsToBigEndianWords(source, row, width);
+        } else {
+          floatsToBytes(source, row, width);
+        }
+      },
+      compressionLevel);
+}
+}  // namespace utils
+}  // namespace procrock
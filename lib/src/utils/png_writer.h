@@ -0,0 +1,25 @@
+#pragma once
+#include <ostream>
+#include <string>
+
+namespace procrock {
+namespace utils {
+// Writes 8 bit png files with 1 to 4 channels. Bands of rows are filtered and compressed in
+// parallel, every band ends on a byte boundary of the deflate stream and goes into its own
+// IDAT chunk. The bands are written in order as they are done, so only a few of them are held
+// in memory at once.
+// The compression level goes from 0 (stored, fastest) to 9 (smallest), like zlib's.
+// Returns false if the file could not be written.
+bool writePng(const std::string& filePath, int width, int height, int channels,
+              const unsigned char* data, int compressionLevel = 6, bool flipVertically = false);
+
+// Same as above, into a stream opened in binary mode
+bool writePng(std::ostream& stream, int width, int height, int channels,
+              const unsigned char* data, int compressionLevel = 6, bool flipVertically = false);
+
+// Writes grey pngs with 8 or 16 bits from float values in [0, 1]. The rows are converted as the
+// bands are compressed, without a converted copy of the whole image.
+bool writeGreyPng(const std::string& filePath, int width, int height, const float* data,
+                  int bitDepth, int compressionLevel = 6, bool flipVertically = false);
+}  // namespace utils
+}  // namespace procrock
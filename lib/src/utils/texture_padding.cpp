@@ -0,0 +1,125 @@
+#include "utils/texture_padding.h"
+
+#include <procrocklib/task_pool.h>
+
+#include <vector>
+
+namespace procrock {
+namespace utils {
+namespace {
+// Rounds towards negative infinity, unlike the integer division
+inline long long floorDivide(long long numerator, long long denominator) {
+  long long quotient = numerator / denominator;
+  if ((numerator % denominator != 0) && ((numerator < 0) != (denominator < 0))) quotient--;
+  return quotient;
+}
+
+template <typename T>
+void copyTexels(CopyOnWrite<std::vector<T>>& channel, int channels,
+                const std::vector<int>& sources) {
+  if (channel->size() != sources.size() * channels) return;  // channel not generated
+
+  auto& data = channel.write();
+  parallelFor(0, sources.size(), 4096, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      const int source = sources[i];
+      if (source == -1 || source == i) continue;
+      for (int c = 0; c < channels; c++) {
+        data[(channels * i) + c] = data[(channels * source) + c];
+      }
+    }
+  });
+}
+}  // namespace
+
+void padTextures(TextureGroup& texGroup, int distance) {
+  const auto& worldMap = *texGroup.worldMap;
+  const int width = texGroup.width;
+  const int height = texGroup.height;
+  if (distance <= 0 || worldMap.faces.size() != width * height) return;
+
+  // Distance transform after Meijster et al., first the closest covered row in every column
+  // then the closest of those per row, which gives the closest covered texel
+  std::vector<int> sources(width * height);
+  parallelFor(0, width, 64, [&](int begin, int end) {
+    for (int x = begin; x < end; x++) {
+      int closest = -1;
+      for (int y = 0; y < height; y++) {
+        if (worldMap.faces[y * width + x] != -1) closest = y;
+        sources[y * width + x] = closest;
+      }
+      closest = -1;
+      for (int y = height - 1; y >= 0; y--) {
+        if (worldMap.faces[y * width + x] != -1) closest = y;
+        int& row = sources[y * width + x];
+        if (closest != -1 && (row == -1 || closest - y < y - row)) row = closest;
+      }
+    }
+  });
+
+  const long long maxDistance = (long long)distance * distance;
+  parallelFor(0, height, 16, [&](int begin, int end) {
+    std::vector<int> closestRows(width);
+    std::vector<long long> columnDistances(width);  // squared, to the closest covered texel
+    std::vector<int> segmentColumns(width), segmentStarts(width);
+    const long long infinity = (long long)(width + height) * (width + height);
+
+    for (int y = begin; y < end; y++) {
+      int* row = &sources[y * width];
+      for (int x = 0; x < width; x++) {
+        closestRows[x] = row[x];
+        columnDistances[x] = row[x] == -1 ? infinity : (long long)(row[x] - y) * (row[x] - y);
+      }
+
+      // Lower envelope of the parabolas (x - column)^2 + columnDistance
+      auto f = [&](long long x, int column) {
+        return (x - column) * (x - column) + columnDistances[column];
+      };
+      int segment = 0;
+      segmentColumns[0] = 0;
+      segmentStarts[0] = 0;
+      for (int column = 1; column < width; column++) {
+        while (segment >= 0 && f(segmentStarts[segment], segmentColumns[segment]) >
+                                   f(segmentStarts[segment], column)) {
+          segment--;
+        }
+        if (segment < 0) {
+          segment = 0;
+          segmentColumns[0] = column;
+        } else {
+          const int previous = segmentColumns[segment];
+          long long start =
+              1 + floorDivide((long long)column * column - (long long)previous * previous +
+                                  columnDistances[column] - columnDistances[previous],
+                              2LL * (column - previous));
+          if (start < width) {
+            segment++;
+            segmentColumns[segment] = column;
+            segmentStarts[segment] = start;
+          }
+        }
+      }
+
+      for (int x = width - 1; x >= 0; x--) {
+        const int column = segmentColumns[segment];
+        const int closestRow = closestRows[column];
+        if (x == segmentStarts[segment]) segment--;
+
+        if (closestRow == -1 || f(x, column) > maxDistance) {
+          row[x] = -1;
+        } else {
+          row[x] = closestRow * width + column;
+        }
+      }
+    }
+  });
+
+  copyTexels(texGroup.albedoData, texGroup.albedoChannels, sources);
+  copyTexels(texGroup.normalData, 3, sources);
+  copyTexels(texGroup.displacementData, 1, sources);
+  copyTexels(texGroup.roughnessData, 1, sources);
+  copyTexels(texGroup.metalData, 1, sources);
+  copyTexels(texGroup.ambientOccData, 1, sources);
+}
+}  // namespace utils
+}  // namespace procrock
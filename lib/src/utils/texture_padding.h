@@ -0,0 +1,12 @@
+#pragma once
+#include <procrocklib/texture.h>
+
+namespace procrock {
+namespace utils {
+// Fills the texels outside of all faces with the values of the closest texel inside of a face,
+// up to the given distance in texels. Keeps texture filtering and mip mapping from bleeding
+// the unused background into the uv islands.
+// The closest texels come from an exact euclidean distance transform, linear in the texel count.
+void padTextures(TextureGroup& texGroup, int distance);
+}  // namespace utils
+}  // namespace procrock
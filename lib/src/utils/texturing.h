@@ -1,58 +1,194 @@
 #pragma once
+#include <procrocklib/configurables/noise_program.h>
+#include <procrocklib/configurables/texturing.h>
 #include <procrocklib/mesh.h>
+#include <procrocklib/task_pool.h>
 
-#include <thread>
-
-#include "utils/vector.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 namespace procrock {
 namespace utils {
 typedef std::function<float(Eigen::Vector3f)> FloatTextureFunction;
 
-inline void fillPart(std::vector<float>& data, int startIndex, int endIndex,
-                     const std::vector<TextureGroup::WorldMapEntry>& entries,
-                     FloatTextureFunction texFunction) {
-  for (int i = startIndex; i < endIndex; i++) {
-    const auto& pixel = entries[i];
+// Amount of texels filled by one task
+const int textureChunkSize = 4096;
 
-    float acc = 0;
-    for (const auto& pos : pixel.positions) {
-      acc += texFunction(pos);
+// Edge length of the tiles textures are processed in, all channels of a tile fit in cache
+const int textureTileSize = 64;
+
+// Runs tileFunction(tile) for every tile of the texture group, the tiles are spread over the
+// task pool
+template <typename TileFunction>
+inline void forEachTile(const TextureGroup& texGroup, const TileFunction& tileFunction) {
+  const int tilesX = (texGroup.width + textureTileSize - 1) / textureTileSize;
+  const int tilesY = (texGroup.height + textureTileSize - 1) / textureTileSize;
+
+  parallelFor(0, tilesX * tilesY, 1, [&](int begin, int end) {
+    for (int t = begin; t < end; t++) {
+      TextureGroup::Tile tile;
+      tile.x = (t % tilesX) * textureTileSize;
+      tile.y = (t / tilesX) * textureTileSize;
+      tile.width = std::min<int>(textureTileSize, texGroup.width - tile.x);
+      tile.height = std::min<int>(textureTileSize, texGroup.height - tile.y);
+      tileFunction(tile);
     }
+  });
+}
 
-    int index = i - startIndex;
-    acc /= pixel.positions.size();
-    data[index] = acc;
+// Runs texelFunction(index) for the texels of a tile, row by row
+template <typename TexelFunction>
+inline void forEachTexel(const TextureGroup& texGroup, const TextureGroup::Tile& tile,
+                         const TexelFunction& texelFunction) {
+  for (int y = tile.y; y < tile.y + tile.height; y++) {
+    const int row = y * texGroup.width;
+    for (int x = tile.x; x < tile.x + tile.width; x++) {
+      texelFunction(row + x);
+    }
   }
 }
 
+// Runs a modifier that supports tiles over the whole texture group
+inline void modifyTiled(TextureGroupModifier& modifier, TextureGroup& texGroup) {
+  modifier.prepareTiles(texGroup);
+  forEachTile(texGroup,
+              [&](const TextureGroup::Tile& tile) { modifier.modifyTile(texGroup, tile); });
+}
+
+// Runs fillTexels(data, texels, texelCount, offsets, offsetCount) over the whole texture.
+// fillTexels writes the average of the samples at the given offsets for every listed texel,
+// every task works on its own texels. Adaptive sampling takes the center sample first and
+// fills the texels close to an edge in the texture again with all sample offsets.
+template <typename FillTexels>
+inline void fillSampledTexture(const TextureGroup& texGroup, std::vector<float>& dataToFill,
+                               const FillTexels& fillTexels) {
+  const auto& worldMap = *texGroup.worldMap;
+  const int width = texGroup.width;
+  const int size = texGroup.width * texGroup.height;
+  dataToFill.resize(size);
+
+  const Eigen::Vector2f center(0.5f, 0.5f);
+  const bool adaptive = worldMap.adaptiveThreshold > 0;
+  const bool centerOnly = adaptive || worldMap.sampleOffsets.empty();
+  const Eigen::Vector2f* offsets = centerOnly ? &center : worldMap.sampleOffsets.data();
+  const int offsetCount = centerOnly ? 1 : worldMap.sampleOffsets.size();
+
+  parallelFor(0, size, textureChunkSize, [&](int begin, int end) {
+    thread_local std::vector<int> texels;
+    texels.resize(end - begin);
+    for (int i = begin; i < end; i++) texels[i - begin] = i;
+    fillTexels(dataToFill.data(), texels.data(), end - begin, offsets, offsetCount);
+  });
+
+  if (!adaptive || worldMap.sampleOffsets.empty()) return;
+
+  // Decide first, the refinement changes the values the neighbours are compared to
+  std::vector<char> refine(size);
+  const float* data = dataToFill.data();
+  const float threshold = worldMap.adaptiveThreshold;
+  parallelFor(0, size, textureChunkSize, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      const int x = i % width;
+      refine[i] = (x > 0 && std::abs(data[i] - data[i - 1]) > threshold) ||
+                  (x < width - 1 && std::abs(data[i] - data[i + 1]) > threshold) ||
+                  (i >= width && std::abs(data[i] - data[i - width]) > threshold) ||
+                  (i + width < size && std::abs(data[i] - data[i + width]) > threshold);
+    }
+  });
+
+  parallelFor(0, size, textureChunkSize, [&](int begin, int end) {
+    thread_local std::vector<int> texels;
+    texels.clear();
+    for (int i = begin; i < end; i++) {
+      if (refine[i]) texels.push_back(i);
+    }
+    if (texels.empty()) return;
+    fillTexels(dataToFill.data(), texels.data(), texels.size(), worldMap.sampleOffsets.data(),
+               worldMap.sampleOffsets.size());
+  });
+}
+
 inline void fillFloatTexture(TextureGroup& texGroup, FloatTextureFunction texFunction,
                              std::vector<float>& dataToFill) {
-  dataToFill.resize(texGroup.width * texGroup.height);
-  std::fill(dataToFill.begin(), dataToFill.end(), 0);
+  const auto& worldMap = *texGroup.worldMap;
+  fillSampledTexture(texGroup, dataToFill,
+                     [&](float* data, const int* texels, int texelCount,
+                         const Eigen::Vector2f* offsets, int offsetCount) {
+                       for (int t = 0; t < texelCount; t++) {
+                         float acc = 0;
+                         for (int o = 0; o < offsetCount; o++) {
+                           acc += texFunction(worldMap.getPosition(texels[t], offsets[o]));
+                         }
+                         data[texels[t]] = acc / offsetCount;
+                       }
+                     });
+}
+
+// Evaluates the compiled noise program for all samples of the texels at once
+inline void fillTexelsNoise(float* data, const int* texels, int texelCount,
+                            const Eigen::Vector2f* offsets, int offsetCount,
+                            const TextureGroup::WorldMap& worldMap, const NoiseProgram& program) {
+  const int sampleCount = texelCount * offsetCount;
 
-  const auto threadCount = std::thread::hardware_concurrency();
-  int batchCount = dataToFill.size() / threadCount;
+  // Reused between the parts a thread fills, so there are no allocations per part
+  thread_local std::vector<double> x, y, z, values;
+  if (values.size() < sampleCount) {
+    x.resize(sampleCount);
+    y.resize(sampleCount);
+    z.resize(sampleCount);
+    values.resize(sampleCount);
+  }
+
+  for (int t = 0; t < texelCount; t++) {
+    for (int o = 0; o < offsetCount; o++) {
+      Eigen::Vector3f position = worldMap.getPosition(texels[t], offsets[o]);
+      int sample = t * offsetCount + o;
+      x[sample] = position.x();
+      y[sample] = position.y();
+      z[sample] = position.z();
+    }
+  }
 
-  std::vector<std::thread> threads;
-  auto data = utils::splitVector(dataToFill, batchCount);
+  program.evaluate(x.data(), y.data(), z.data(), values.data(), sampleCount);
 
-  int sizeAcc = 0;
-  for (int i = 0; i < data.size(); i++) {
-    if (i != 0) {
-      sizeAcc += data[i - 1].size();
+  for (int t = 0; t < texelCount; t++) {
+    float acc = 0;
+    for (int o = 0; o < offsetCount; o++) {
+      float value = (values[t * offsetCount + o] + 1) / 2;
+      acc += std::max(0.0f, std::min(value, 1.0f));
     }
-    int startIndex = sizeAcc;
-    threads.emplace_back(std::thread(&fillPart, std::ref(data[i]), startIndex,
-                                     startIndex + data[i].size(), std::cref(texGroup.worldMap),
-                                     texFunction));
+    data[texels[t]] = acc / offsetCount;
   }
+}
 
-  dataToFill.clear();
-  for (int i = 0; i < data.size(); i++) {
-    threads[i].join();
-    dataToFill.insert(dataToFill.end(), data[i].begin(), data[i].end());
+// Fills the texture with the noise graph values mapped from [-1, 1] to [0, 1]
+inline void fillFloatTexture(TextureGroup& texGroup, const NoiseGraph& noiseGraph,
+                             std::vector<float>& dataToFill) {
+  if (!isNoiseCompilationEnabled()) {
+    auto noiseModule = evaluateGraph(noiseGraph);
+    auto noiseFunction = [&](Eigen::Vector3f worldPos) {
+      if (noiseModule == nullptr) return 0.0f;
+      float value = (noiseModule->GetValue(worldPos.x(), worldPos.y(), worldPos.z()) + 1) / 2;
+      return std::max(0.0f, std::min(value, 1.0f));
+    };
+    fillFloatTexture(texGroup, noiseFunction, dataToFill);
+    return;
   }
+
+  NoiseProgram program(noiseGraph);
+  if (program.isEmpty()) {
+    dataToFill.assign(texGroup.width * texGroup.height, 0);
+    return;
+  }
+
+  const auto& worldMap = *texGroup.worldMap;
+  fillSampledTexture(texGroup, dataToFill,
+                     [&](float* data, const int* texels, int texelCount,
+                         const Eigen::Vector2f* offsets, int offsetCount) {
+                       fillTexelsNoise(data, texels, texelCount, offsets, offsetCount, worldMap,
+                                       program);
+                     });
 }
 
 }  // namespace utils